@@ -0,0 +1,126 @@
+#include "AsyncDataFrameWriter.hpp"
+#include "CsvWriter.hpp"
+#include <cassert>
+
+namespace jdf {
+
+AsyncDataFrameWriter::AsyncDataFrameWriter(const json& data, std::string_view path, AsyncWriterOptions options)
+    : _columnNames(DataFrame(data).columnNames())
+    , _options(std::move(options))
+    , _file(std::string { path })
+    , _pending(data)
+    , _pendingSince(std::chrono::steady_clock::now())
+    , _rowCount(_pending.size())
+{
+    assert(_file.is_open());
+    assert(_options.flushRows > 0 && _options.maxQueuedBatches > 0);
+    std::string header;
+    csv::formatHeader(_pending, _options.delimiter, header);
+    _file << header;
+    _thread = std::thread([this] { run(); });
+}
+
+AsyncDataFrameWriter::~AsyncDataFrameWriter()
+{
+    {
+        const std::lock_guard lock(_mutex);
+        _isStopping = true;
+    }
+    _queueChanged.notify_all();
+    _thread.join();
+}
+
+void AsyncDataFrameWriter::addRow(const json& row)
+{
+    std::unique_lock lock(_mutex);
+    if (_pending.size() == 0) {
+        _pendingSince = std::chrono::steady_clock::now();
+    }
+    _pending.addRow(row);
+    _rowCount++;
+    afterAdding(lock);
+}
+
+void AsyncDataFrameWriter::appendRows(const json& rows)
+{
+    std::unique_lock lock(_mutex);
+    const size_t size = _pending.size();
+    if (size == 0) {
+        _pendingSince = std::chrono::steady_clock::now();
+    }
+    _pending.appendRows(rows);
+    _rowCount += _pending.size() - size;
+    afterAdding(lock);
+}
+
+void AsyncDataFrameWriter::flush()
+{
+    std::unique_lock lock(_mutex);
+    enqueue(lock);
+}
+
+size_t AsyncDataFrameWriter::rowCount() const
+{
+    const std::lock_guard lock(_mutex);
+    return _rowCount;
+}
+
+void AsyncDataFrameWriter::afterAdding(std::unique_lock<std::mutex>& lock)
+{
+    if (_pending.size() >= _options.flushRows) {
+        enqueue(lock);
+    } else if (_pending.size() > 0) {
+        // Wakes up the I/O thread, which flushes the rows once they are flushInterval old.
+        _queueChanged.notify_all();
+    }
+}
+
+void AsyncDataFrameWriter::enqueue(std::unique_lock<std::mutex>& lock)
+{
+    _queueChanged.wait(lock, [&] { return _queue.size() < _options.maxQueuedBatches; });
+    // The I/O thread may have taken the pending rows while this thread was waiting.
+    if (_pending.size() == 0) {
+        return;
+    }
+    _queue.push_back(std::exchange(_pending, DataFrame(json(_columnNames))));
+    _queueChanged.notify_all();
+}
+
+void AsyncDataFrameWriter::run()
+{
+    std::string buffer;
+    std::unique_lock lock(_mutex);
+    while (true) {
+        if (_queue.empty() && _pending.size() > 0) {
+            // The pending rows are due flushInterval after the first of them was added.
+            const auto deadline = _pendingSince + _options.flushInterval;
+            _queueChanged.wait_until(lock, deadline, [&] { return !_queue.empty() || _isStopping; });
+            if (_queue.empty() && _pending.size() > 0 && (_isStopping || std::chrono::steady_clock::now() >= deadline)) {
+                _queue.push_back(std::exchange(_pending, DataFrame(json(_columnNames))));
+            }
+        } else {
+            _queueChanged.wait(lock, [&] { return !_queue.empty() || _pending.size() > 0 || _isStopping; });
+        }
+
+        if (_queue.empty()) {
+            if (_isStopping && _pending.size() == 0) {
+                break;
+            }
+            continue;
+        }
+
+        DataFrame batch = std::move(_queue.front());
+        _queue.pop_front();
+        lock.unlock();
+        _queueChanged.notify_all();
+
+        buffer.clear();
+        csv::formatRows(batch, 0, batch.size(), _options.delimiter, buffer);
+        _file.write(buffer.data(), buffer.size());
+        _file.flush();
+
+        lock.lock();
+    }
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "DataFrame.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace jdf {
+
+struct AsyncWriterOptions {
+    /**
+     * Pending rows are handed to the I/O thread once there are flushRows of them, or once the oldest of
+     * them is flushInterval old.
+     */
+    size_t flushRows = 1 << 16;
+    std::chrono::milliseconds flushInterval { 1000 };
+
+    /**
+     * The maximum number of batches waiting for the I/O thread. Adding rows blocks while the queue is full.
+     */
+    size_t maxQueuedBatches = 4;
+    std::string delimiter = ",";
+};
+
+/**
+ * Writes rows to a csv file incrementally, on a background I/O thread. Rows are collected in a batch that
+ * is queued for writing when a row count or time threshold is reached, after which the rows are released.
+ * The destructor only writes the rows that have not been written yet.
+ * Unlike DataFrameWriter, the written rows are not kept in memory, so they cannot be queried.
+ */
+class AsyncDataFrameWriter {
+public:
+    /**
+     * @param data The columns and initial rows, in any format accepted by the DataFrame constructor.
+     */
+    AsyncDataFrameWriter(const json& data, std::string_view path, AsyncWriterOptions options = {});
+    ~AsyncDataFrameWriter();
+
+    AsyncDataFrameWriter(const AsyncDataFrameWriter&) = delete;
+    AsyncDataFrameWriter(AsyncDataFrameWriter&&) = delete;
+    AsyncDataFrameWriter& operator=(const AsyncDataFrameWriter&) = delete;
+    AsyncDataFrameWriter& operator=(AsyncDataFrameWriter&&) = delete;
+
+    /**
+     * Adds rows in the formats accepted by DataFrame::addRow and DataFrame::appendRows.
+     */
+    void addRow(const json& row);
+    void appendRows(const json& rows);
+
+    /**
+     * Queues the pending rows for writing without waiting for them to be written.
+     */
+    void flush();
+
+    /**
+     * Returns the number of rows added so far, written or not.
+     */
+    size_t rowCount() const;
+
+private:
+    void afterAdding(std::unique_lock<std::mutex>& lock);
+    void enqueue(std::unique_lock<std::mutex>& lock);
+    void run();
+
+    const std::vector<std::string> _columnNames;
+    const AsyncWriterOptions _options;
+    std::ofstream _file;
+    mutable std::mutex _mutex;
+    std::condition_variable _queueChanged;
+    DataFrame _pending;
+    std::chrono::steady_clock::time_point _pendingSince;
+    std::deque<DataFrame> _queue;
+    size_t _rowCount = 0;
+    bool _isStopping = false;
+    std::thread _thread;
+};
+
+}
@@ -0,0 +1,263 @@
+#include "BinaryFormat.hpp"
+#include "DataFrame.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace jdf::binary {
+
+namespace {
+    constexpr std::string_view magic = "JDFBIN01";
+    constexpr size_t versionSize = 2;
+    constexpr size_t alignment = 64;
+    constexpr size_t preambleSize = magic.size() + sizeof(uint64_t);
+
+    constexpr size_t align(size_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    std::string_view typeName(ColumnType type)
+    {
+        switch (type) {
+        case ColumnType::Empty:
+            return "empty";
+        case ColumnType::Int:
+            return "int";
+        case ColumnType::Double:
+            return "double";
+        case ColumnType::Bool:
+            return "bool";
+        case ColumnType::String:
+            return "string";
+        case ColumnType::Json:
+            return "json";
+        }
+        return "";
+    }
+
+    ColumnType typeFromName(std::string_view name)
+    {
+        for (const auto type : { ColumnType::Int, ColumnType::Double, ColumnType::Bool, ColumnType::String, ColumnType::Json }) {
+            if (typeName(type) == name) {
+                return type;
+            }
+        }
+        return ColumnType::Empty;
+    }
+
+    /**
+     * The buffers of one column. Numeric buffers point into the column, string offsets and characters
+     * and serialized json are kept in storage.
+     */
+    struct ColumnBuffers {
+        std::vector<std::string_view> buffers;
+        std::vector<uint64_t> offsets;
+        std::string storage;
+    };
+
+    template <typename T>
+    std::string_view bytesOf(std::span<const T> values)
+    {
+        return std::string_view(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+    }
+
+    void collectBuffers(const Column& column, ColumnBuffers& result)
+    {
+        switch (column.type()) {
+        case ColumnType::Int:
+            result.buffers.push_back(bytesOf(column.values<int64_t>()));
+            result.buffers.push_back(bytesOf(column.zoneMap().intBounds()));
+            break;
+        case ColumnType::Double:
+            result.buffers.push_back(bytesOf(column.values<double>()));
+            result.buffers.push_back(bytesOf(column.zoneMap().doubleBounds()));
+            break;
+        case ColumnType::Bool:
+            result.buffers.push_back(bytesOf(column.values<uint8_t>()));
+            break;
+        case ColumnType::String:
+            result.offsets.assign(column.size() + 1, 0);
+            for (size_t row = 0; row < column.size(); row++) {
+                result.storage += column.string(row);
+                result.offsets[row + 1] = result.storage.size();
+            }
+            result.buffers.push_back(bytesOf(std::span<const uint64_t>(result.offsets)));
+            result.buffers.push_back(result.storage);
+            break;
+        case ColumnType::Json:
+            result.storage = json(column.values<json>()).dump();
+            result.buffers.push_back(result.storage);
+            break;
+        case ColumnType::Empty:
+            break;
+        }
+        if (column.nulls() != nullptr) {
+            result.buffers.push_back(bytesOf(std::span<const uint64_t>(column.nulls()->words(), column.nulls()->wordCount())));
+        }
+    }
+}
+
+void write(const DataFrame& dataFrame, std::string_view path)
+{
+    std::vector<ColumnBuffers> columns(dataFrame.columnCount());
+    json header = { { "rows", dataFrame.size() }, { "columns", json::array() } };
+    size_t offset = 0;
+    for (size_t column = 0; column < dataFrame.columnCount(); column++) {
+        collectBuffers(dataFrame.column(column), columns[column]);
+        json buffers = json::array();
+        for (const auto buffer : columns[column].buffers) {
+            offset = align(offset);
+            buffers.push_back({ offset, buffer.size() });
+            offset += buffer.size();
+        }
+        json columnHeader = { { "name", dataFrame.columnNames()[column] },
+            { "type", typeName(dataFrame.column(column).type()) },
+            { "buffers", std::move(buffers) } };
+        if (dataFrame.column(column).nulls() != nullptr) {
+            columnHeader["nulls"] = true;
+        }
+        header["columns"].push_back(std::move(columnHeader));
+    }
+
+    std::ofstream file(std::string { path }, std::ios::binary);
+    assert(file.is_open());
+    const char padding[alignment] = {};
+    const std::string headerText = header.dump();
+    const uint64_t headerSize = headerText.size();
+    file.write(magic.data(), magic.size());
+    file.write(reinterpret_cast<const char*>(&headerSize), sizeof(headerSize));
+    file << headerText;
+    file.write(padding, align(preambleSize + headerSize) - preambleSize - headerSize);
+
+    offset = 0;
+    for (const auto& column : columns) {
+        for (const auto buffer : column.buffers) {
+            file.write(padding, align(offset) - offset);
+            file << buffer;
+            offset = align(offset) + buffer.size();
+        }
+    }
+    assert(file.good());
+}
+
+DataFrame map(std::string_view path)
+{
+    // The mapping is read column by column in whatever order the DataFrame is used, so no access pattern
+    // is advised.
+    const auto file = std::make_shared<const MappedFile>(path, MappedFile::Access::Random);
+    const std::string_view content = file->data();
+    const auto invalid = [&](std::string_view reason) {
+        return std::invalid_argument("invalid binary DataFrame file " + std::string(path) + ": " + std::string(reason));
+    };
+    if (content.size() < preambleSize || !content.starts_with(magic.substr(0, magic.size() - versionSize))) {
+        throw invalid("wrong magic");
+    }
+    if (!content.starts_with(magic)) {
+        throw invalid("unsupported version " + std::string(content.substr(magic.size() - versionSize, versionSize)));
+    }
+    uint64_t headerSize;
+    std::memcpy(&headerSize, content.data() + magic.size(), sizeof(headerSize));
+    if (headerSize > content.size() - preambleSize) {
+        throw invalid("the header is truncated");
+    }
+    const std::string_view data = content.substr(std::min(align(preambleSize + headerSize), content.size()));
+
+    try {
+        const json header = json::parse(content.substr(preambleSize, headerSize));
+        const size_t rows = header.at("rows").get<size_t>();
+        // Every row takes at least one byte in each column.
+        if (rows > data.size()) {
+            throw invalid("the row count exceeds the file size");
+        }
+
+        const auto buffer = [&](const json& buffers, size_t index, size_t expectedSize = std::string_view::npos) {
+            const size_t offset = buffers.at(index).at(0).get<size_t>();
+            const size_t size = buffers.at(index).at(1).get<size_t>();
+            if (offset % alignment != 0 || offset > data.size() || size > data.size() - offset) {
+                throw invalid("a buffer lies outside of the file");
+            }
+            if (expectedSize != std::string_view::npos && size != expectedSize) {
+                throw invalid("a buffer has the wrong size");
+            }
+            return data.substr(offset, size);
+        };
+        const auto view = [&]<typename T>(std::string_view bytes) {
+            return ColumnBuffer<T>(std::span<const T>(reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)), file);
+        };
+        const size_t boundsSize = 2 * ((rows + ZoneMap::blockSize - 1) / ZoneMap::blockSize);
+        const auto zoneMap = [&]<typename T>(std::string_view bytes) {
+            const auto bounds = reinterpret_cast<const T*>(bytes.data());
+            return ZoneMap(rows, std::vector<T>(bounds, bounds + bytes.size() / sizeof(T)));
+        };
+        const auto nulls = [&](const json& buffers, bool hasNulls) {
+            if (!hasNulls) {
+                return Bitmap();
+            }
+            const auto words = buffer(buffers, buffers.size() - 1, Bitmap::wordCount(rows) * sizeof(uint64_t));
+            const auto begin = reinterpret_cast<const uint64_t*>(words.data());
+            return Bitmap(rows, std::vector<uint64_t>(begin, begin + words.size() / sizeof(uint64_t)));
+        };
+
+        std::vector<std::string> columnNames;
+        std::vector<Column> columns;
+        for (const auto& column : header.at("columns")) {
+            columnNames.push_back(column.at("name").get<std::string>());
+            const std::string typeNameValue = column.at("type").get<std::string>();
+            const ColumnType type = typeFromName(typeNameValue);
+            if (typeName(type) != typeNameValue) {
+                throw invalid("unknown column type " + typeNameValue);
+            }
+            const json& buffers = column.at("buffers");
+            const bool hasNulls = column.value("nulls", false);
+            const size_t valueBufferCounts[] = { 0, 2, 2, 1, 2, 1 };
+            const bool canHaveNulls = type != ColumnType::Json && type != ColumnType::Empty;
+            if (!buffers.is_array() || buffers.size() != valueBufferCounts[static_cast<size_t>(type)] + hasNulls || (hasNulls && !canHaveNulls)) {
+                throw invalid("column " + columnNames.back() + " has the wrong number of buffers");
+            }
+            switch (type) {
+            case ColumnType::Int:
+                columns.emplace_back(view.operator()<int64_t>(buffer(buffers, 0, rows * sizeof(int64_t))), zoneMap.operator()<int64_t>(buffer(buffers, 1, boundsSize * sizeof(int64_t))), nulls(buffers, hasNulls));
+                break;
+            case ColumnType::Double:
+                columns.emplace_back(view.operator()<double>(buffer(buffers, 0, rows * sizeof(double))), zoneMap.operator()<double>(buffer(buffers, 1, boundsSize * sizeof(double))), nulls(buffers, hasNulls));
+                break;
+            case ColumnType::Bool:
+                columns.emplace_back(view.operator()<uint8_t>(buffer(buffers, 0, rows)), ZoneMap(), nulls(buffers, hasNulls));
+                break;
+            case ColumnType::String: {
+                const auto offsetBytes = buffer(buffers, 0, (rows + 1) * sizeof(uint64_t));
+                const auto characters = buffer(buffers, 1);
+                const std::span<const uint64_t> offsets(reinterpret_cast<const uint64_t*>(offsetBytes.data()), rows + 1);
+                if (offsets.front() != 0 || !std::is_sorted(offsets.begin(), offsets.end()) || offsets.back() > characters.size()) {
+                    throw invalid("column " + columnNames.back() + " has invalid string offsets");
+                }
+                columns.emplace_back(StringBuffer(offsets, characters.data(), file), ZoneMap(), nulls(buffers, hasNulls));
+                break;
+            }
+            case ColumnType::Json: {
+                json values = json::parse(buffer(buffers, 0));
+                if (!values.is_array() || values.size() != rows) {
+                    throw invalid("column " + columnNames.back() + " does not have a value per row");
+                }
+                columns.emplace_back(values);
+                break;
+            }
+            case ColumnType::Empty:
+                if (rows != 0) {
+                    throw invalid("column " + columnNames.back() + " does not have a value per row");
+                }
+                columns.emplace_back();
+                break;
+            }
+        }
+        return DataFrame(std::move(columnNames), std::move(columns));
+    } catch (const json::exception& error) {
+        throw invalid(error.what());
+    }
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <string_view>
+
+namespace jdf {
+
+class DataFrame;
+
+/**
+ * A self-describing columnar file format that can be memory mapped.
+ * A file starts with the 8 byte magic "JDFBIN01" and the 8 byte size of a json header, followed by the
+ * header itself:
+ *   {
+ *    "rows": 2,
+ *    "columns": [{"name": "col1", "type": "int", "buffers": [[0, 16]]}, ...]
+ *   }
+ * Each buffer is given as [offset, size] in bytes, relative to the first multiple of 64 after the header,
+ * and starts at a multiple of 64 itself. Int, Double and Bool columns have a buffer of raw int64_t,
+ * double and uint8_t values, Int and Double columns followed by a buffer with the bounds of their zone
+ * map. String columns have a buffer of rows + 1 uint64_t offsets and a buffer of
+ * characters. Json columns have a single buffer with the values serialized as a json array.
+ * Columns of other types with null rows have "nulls": true and a last buffer with the uint64_t words of
+ * a bitmap of the null rows.
+ * Values are stored in the byte order of the machine that wrote the file.
+ */
+namespace binary {
+
+    void write(const DataFrame& dataFrame, std::string_view path);
+
+    /**
+     * Maps a file written by write(). The columns of the returned DataFrame are views of the mapping,
+     * except for Json columns, which are parsed.
+     * @throws std::system_error if the file cannot be mapped.
+     * @throws std::invalid_argument if the file is not in this format, e.g. has another magic or version,
+     * or its header describes buffers that do not fit the file or the row count.
+     */
+    DataFrame map(std::string_view path);
+
+}
+
+}
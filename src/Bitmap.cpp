@@ -0,0 +1,128 @@
+#include "Bitmap.hpp"
+#include "MemoryUsage.hpp"
+#include <bit>
+#include <cassert>
+#include <utility>
+
+namespace jdf {
+
+Bitmap::Bitmap(size_t size, bool value)
+    : _words(wordCount(size), value ? ~uint64_t { 0 } : 0)
+    , _size(size)
+{
+    clearTail();
+}
+
+Bitmap::Bitmap(size_t size, std::vector<uint64_t> words)
+    : _words(std::move(words))
+    , _size(size)
+{
+    assert(_words.size() == wordCount(size));
+    clearTail();
+}
+
+size_t Bitmap::size() const
+{
+    return _size;
+}
+
+size_t Bitmap::wordCount() const
+{
+    return _words.size();
+}
+
+uint64_t* Bitmap::words()
+{
+    return _words.data();
+}
+
+const uint64_t* Bitmap::words() const
+{
+    return _words.data();
+}
+
+bool Bitmap::test(size_t index) const
+{
+    assert(index < _size);
+    return (_words[index / 64] >> (index % 64)) & 1;
+}
+
+void Bitmap::set(size_t index)
+{
+    assert(index < _size);
+    _words[index / 64] |= uint64_t { 1 } << (index % 64);
+}
+
+void Bitmap::resize(size_t size)
+{
+    _words.resize(wordCount(size), 0);
+    _size = size;
+    clearTail();
+}
+
+size_t Bitmap::count() const
+{
+    return count(0, _words.size());
+}
+
+std::vector<size_t> Bitmap::indices() const
+{
+    std::vector<size_t> indices(count());
+    this->indices(0, _words.size(), indices.data());
+    return indices;
+}
+
+size_t Bitmap::count(size_t beginWord, size_t endWord) const
+{
+    assert(beginWord <= endWord && endWord <= _words.size());
+    size_t count = 0;
+    for (size_t w = beginWord; w < endWord; w++) {
+        count += std::popcount(_words[w]);
+    }
+    return count;
+}
+
+size_t* Bitmap::indices(size_t beginWord, size_t endWord, size_t* out) const
+{
+    assert(beginWord <= endWord && endWord <= _words.size());
+    for (size_t w = beginWord; w < endWord; w++) {
+        uint64_t word = _words[w];
+        while (word != 0) {
+            *out++ = w * 64 + std::countr_zero(word);
+            word &= word - 1;
+        }
+    }
+    return out;
+}
+
+Bitmap& Bitmap::operator&=(const Bitmap& other)
+{
+    assert(_size == other._size);
+    for (size_t w = 0; w < _words.size(); w++) {
+        _words[w] &= other._words[w];
+    }
+    return *this;
+}
+
+Bitmap& Bitmap::operator|=(const Bitmap& other)
+{
+    assert(_size == other._size);
+    for (size_t w = 0; w < _words.size(); w++) {
+        _words[w] |= other._words[w];
+    }
+    return *this;
+}
+
+size_t Bitmap::memoryUsage() const
+{
+    return memory::vectorSize(_words);
+}
+
+void Bitmap::clearTail()
+{
+    if (_size % 64 != 0) {
+        _words.back() &= (uint64_t { 1 } << (_size % 64)) - 1;
+    }
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * A set of bits, used as the selection vector of a query and for the null rows of a column.
+ * Bit i of word w represents row 64 * w + i. Bits past size() are always zero.
+ */
+class Bitmap {
+public:
+    explicit Bitmap(size_t size = 0, bool value = false);
+
+    /**
+     * Constructs a bitmap from wordCount(size) words, e.g. read from a file. Bits past size are cleared.
+     */
+    Bitmap(size_t size, std::vector<uint64_t> words);
+
+    static constexpr size_t wordCount(size_t size)
+    {
+        return (size + 63) / 64;
+    }
+
+    size_t size() const;
+    size_t wordCount() const;
+    uint64_t* words();
+    const uint64_t* words() const;
+
+    bool test(size_t index) const;
+    void set(size_t index);
+
+    /**
+     * Changes the number of bits, added bits are zero.
+     */
+    void resize(size_t size);
+
+    /**
+     * Returns the number of set bits.
+     */
+    size_t count() const;
+
+    /**
+     * Returns the indices of all set bits in ascending order.
+     */
+    std::vector<size_t> indices() const;
+
+    /**
+     * Variants of count() and indices() restricted to the words [beginWord, endWord), which allow
+     * collecting the indices of disjoint word ranges in parallel. indices writes to out and returns the
+     * end of the written indices.
+     */
+    size_t count(size_t beginWord, size_t endWord) const;
+    size_t* indices(size_t beginWord, size_t endWord, size_t* out) const;
+
+    Bitmap& operator&=(const Bitmap& other);
+    Bitmap& operator|=(const Bitmap& other);
+
+    size_t memoryUsage() const;
+
+private:
+    void clearTail();
+
+    std::vector<uint64_t> _words;
+    size_t _size;
+};
+
+}
@@ -0,0 +1,44 @@
+#include "BlockReader.hpp"
+
+namespace jdf {
+
+namespace {
+    constexpr size_t blockSize = 1 << 20;
+
+    std::string readBlockFrom(std::istream& stream)
+    {
+        std::string block(blockSize, '\0');
+        stream.read(block.data(), block.size());
+        block.resize(stream.gcount());
+        return block;
+    }
+}
+
+BlockReader::BlockReader(std::istream& stream)
+    : _stream(&stream)
+    , _nextBlock(std::async(std::launch::async, readBlockFrom, std::ref(stream)))
+{
+}
+
+std::optional<size_t> BlockReader::appendTo(std::string& buffer, size_t begin)
+{
+    if (_isEndOfInput) {
+        return std::nullopt;
+    }
+    const std::string block = _nextBlock.get();
+    if (block.empty()) {
+        _isEndOfInput = true;
+        return std::nullopt;
+    }
+    _nextBlock = std::async(std::launch::async, readBlockFrom, std::ref(*_stream));
+
+    size_t dropped = 0;
+    if (begin > 0 && begin >= buffer.size() / 2) {
+        buffer.erase(0, begin);
+        dropped = begin;
+    }
+    buffer += block;
+    return dropped;
+}
+
+}
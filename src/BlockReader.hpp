@@ -0,0 +1,31 @@
+#pragma once
+#include <future>
+#include <istream>
+#include <optional>
+#include <string>
+
+namespace jdf {
+
+/**
+ * Reads an input stream in blocks for the batch readers. The next block is read in the background while
+ * the previous blocks are parsed and processed.
+ */
+class BlockReader {
+public:
+    explicit BlockReader(std::istream& stream);
+
+    /**
+     * Appends the block that is read in the background to buffer and starts reading the next one. The
+     * characters of buffer before begin have been consumed and are dropped first if they make up at least
+     * half of it. Returns the number of dropped characters, which positions in buffer have to be moved by,
+     * or std::nullopt at the end of the input.
+     */
+    std::optional<size_t> appendTo(std::string& buffer, size_t begin);
+
+private:
+    std::istream* _stream;
+    std::future<std::string> _nextBlock;
+    bool _isEndOfInput = false;
+};
+
+}
@@ -0,0 +1,531 @@
+#include "Column.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+namespace jdf {
+
+namespace {
+    ColumnType typeOf(const json& value)
+    {
+        if (value.is_number_unsigned()) {
+            const bool fitsInt = value.get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+            return fitsInt ? ColumnType::Int : ColumnType::Json;
+        }
+        if (value.is_number_integer()) {
+            return ColumnType::Int;
+        }
+        if (value.is_number_float()) {
+            return ColumnType::Double;
+        }
+        if (value.is_boolean()) {
+            return ColumnType::Bool;
+        }
+        if (value.is_string()) {
+            return ColumnType::String;
+        }
+        return ColumnType::Json;
+    }
+
+    bool isNumeric(ColumnType type)
+    {
+        return type == ColumnType::Int || type == ColumnType::Double;
+    }
+
+    /**
+     * Returns whether an integer survives the conversion to double, which holds for all integers up to
+     * 2^53 and for larger ones with enough trailing zero bits.
+     */
+    bool isExactDouble(int64_t value)
+    {
+        const double converted = static_cast<double>(value);
+        return converted >= -0x1p63 && converted < 0x1p63 && static_cast<int64_t>(converted) == value;
+    }
+
+    template <typename T>
+    void gather(std::span<const T> values, std::span<const size_t> rows, std::vector<T>& out)
+    {
+        out.reserve(out.size() + rows.size());
+        for (const size_t row : rows) {
+            out.push_back(values[row]);
+        }
+    }
+
+    template <typename T>
+    void appendValues(std::span<const T> values, std::vector<T>& out)
+    {
+        out.insert(out.end(), values.begin(), values.end());
+    }
+}
+
+Column::Column(const json& values)
+{
+    assert(values.is_array());
+    for (const auto& value : values) {
+        push_back(value);
+    }
+}
+
+Column::Column(Storage data)
+    : _data(std::move(data))
+{
+    updateZoneMap();
+}
+
+Column::Column(Storage data, ZoneMap zoneMap, Bitmap nulls)
+    : _data(std::move(data))
+    , _zoneMap(std::move(zoneMap))
+    , _nulls(std::move(nulls))
+{
+    const bool hasZoneMap = type() == ColumnType::Int || type() == ColumnType::Double;
+    assert(_zoneMap.blockCount() == (hasZoneMap ? (size() + ZoneMap::blockSize - 1) / ZoneMap::blockSize : 0));
+    assert(_nulls.size() == 0 || (_nulls.size() == size() && type() != ColumnType::Json));
+}
+
+Column::Column(ColumnType type)
+{
+    convertTo(type);
+    // A Json column that is asked for stays Json.
+    _hasOnlyNulls = false;
+}
+
+ColumnType Column::type() const
+{
+    return static_cast<ColumnType>(_data.index());
+}
+
+size_t Column::size() const
+{
+    return std::visit([](const auto& values) -> size_t {
+        if constexpr (std::is_same_v<std::decay_t<decltype(values)>, std::monostate>) {
+            return 0;
+        } else {
+            return values.size();
+        }
+    },
+        _data);
+}
+
+void Column::push_back(const json& value)
+{
+    switch (typeOf(value)) {
+    case ColumnType::Int:
+        addInt(value.get<int64_t>());
+        return;
+    case ColumnType::Double:
+        addDouble(value.get<double>());
+        return;
+    case ColumnType::Bool:
+        addBool(value.get<bool>());
+        return;
+    case ColumnType::String:
+        addString(value.get_ref<const std::string&>());
+        return;
+    default:
+        break;
+    }
+    if (value.is_null()) {
+        addNull();
+        return;
+    }
+    prepareFor(ColumnType::Json);
+    pushJson(value);
+    finishAppend();
+}
+
+void Column::push_back(json&& value)
+{
+    if (typeOf(value) != ColumnType::Json || value.is_null()) {
+        push_back(std::as_const(value));
+        return;
+    }
+    prepareFor(ColumnType::Json);
+    pushJson(std::move(value));
+    finishAppend();
+}
+
+void Column::addInt(int64_t value)
+{
+    if (type() == ColumnType::Double && !isExactDouble(value)) {
+        convertTo(ColumnType::Json);
+    }
+    switch (prepareFor(ColumnType::Int)) {
+    case ColumnType::Int:
+        mutableValues<int64_t>().push_back(value);
+        break;
+    case ColumnType::Double:
+        mutableValues<double>().push_back(static_cast<double>(value));
+        break;
+    default:
+        pushJson(value);
+        break;
+    }
+    finishAppend();
+}
+
+void Column::addDouble(double value)
+{
+    if (prepareFor(ColumnType::Double) == ColumnType::Double) {
+        mutableValues<double>().push_back(value);
+    } else {
+        pushJson(value);
+    }
+    finishAppend();
+}
+
+void Column::addBool(bool value)
+{
+    if (prepareFor(ColumnType::Bool) == ColumnType::Bool) {
+        mutableValues<uint8_t>().push_back(value);
+    } else {
+        pushJson(value);
+    }
+    finishAppend();
+}
+
+void Column::addString(std::string_view value)
+{
+    if (prepareFor(ColumnType::String) == ColumnType::String) {
+        mutableStrings().push_back(value);
+    } else {
+        pushJson(value);
+    }
+    finishAppend();
+}
+
+void Column::addNull()
+{
+    switch (type()) {
+    case ColumnType::Empty:
+        convertTo(ColumnType::Json);
+        [[fallthrough]];
+    case ColumnType::Json:
+        mutableValues<json>().emplace_back();
+        updateZoneMap();
+        return;
+    case ColumnType::Int:
+        mutableValues<int64_t>().push_back(0);
+        break;
+    case ColumnType::Double:
+        mutableValues<double>().push_back(0.0);
+        break;
+    case ColumnType::Bool:
+        mutableValues<uint8_t>().push_back(0);
+        break;
+    case ColumnType::String:
+        mutableStrings().push_back("");
+        break;
+    }
+    _nulls.resize(size());
+    _nulls.set(size() - 1);
+    updateZoneMap();
+}
+
+void Column::reserve(size_t size)
+{
+    _capacity = size;
+    switch (type()) {
+    case ColumnType::Int:
+        mutableValues<int64_t>().reserve(size);
+        break;
+    case ColumnType::Double:
+        mutableValues<double>().reserve(size);
+        break;
+    case ColumnType::Bool:
+        mutableValues<uint8_t>().reserve(size);
+        break;
+    case ColumnType::String:
+        mutableStrings().reserve(size);
+        break;
+    case ColumnType::Json:
+        mutableValues<json>().reserve(size);
+        break;
+    case ColumnType::Empty:
+        break;
+    }
+}
+
+void Column::append(const Column& other)
+{
+    if (other.type() == ColumnType::Empty) {
+        return;
+    }
+    if (other._hasOnlyNulls && type() != ColumnType::Json && type() != ColumnType::Empty) {
+        for (size_t row = 0; row < other.size(); row++) {
+            addNull();
+        }
+        return;
+    }
+    if (prepareFor(other.type()) != other.type()) {
+        Column converted = other;
+        converted.convertTo(type());
+        append(converted);
+        return;
+    }
+
+    const size_t begin = size();
+    switch (type()) {
+    case ColumnType::Int:
+        appendValues(other.values<int64_t>(), mutableValues<int64_t>());
+        break;
+    case ColumnType::Double:
+        appendValues(other.values<double>(), mutableValues<double>());
+        break;
+    case ColumnType::Bool:
+        appendValues(other.values<uint8_t>(), mutableValues<uint8_t>());
+        break;
+    case ColumnType::String: {
+        auto& strings = mutableStrings();
+        strings.reserve(strings.size() + other.size());
+        for (size_t row = 0; row < other.size(); row++) {
+            strings.push_back(other.string(row));
+        }
+        break;
+    }
+    case ColumnType::Json:
+        appendValues(other.values<json>(), mutableValues<json>());
+        _hasOnlyNulls = _hasOnlyNulls && other._hasOnlyNulls;
+        break;
+    case ColumnType::Empty:
+        break;
+    }
+    if (other.nulls() != nullptr) {
+        _nulls.resize(size());
+        for (size_t row = 0; row < other.size(); row++) {
+            if (other._nulls.test(row)) {
+                _nulls.set(begin + row);
+            }
+        }
+    }
+    finishAppend();
+}
+
+ColumnType Column::prepareFor(ColumnType valueType)
+{
+    if (type() == ColumnType::Json && _hasOnlyNulls && valueType != ColumnType::Json) {
+        convertTo(valueType);
+    } else if (type() != valueType && type() != ColumnType::Json) {
+        if (type() == ColumnType::Empty) {
+            convertTo(valueType);
+        } else if (isNumeric(type()) && isNumeric(valueType)) {
+            convertTo(ColumnType::Double);
+        } else {
+            convertTo(ColumnType::Json);
+        }
+    }
+    return type();
+}
+
+json Column::get(size_t row) const
+{
+    assert(row < size());
+    if (_nulls.size() != 0 && _nulls.test(row)) {
+        return json();
+    }
+    switch (type()) {
+    case ColumnType::Int:
+        return values<int64_t>()[row];
+    case ColumnType::Double:
+        return values<double>()[row];
+    case ColumnType::Bool:
+        return static_cast<bool>(values<uint8_t>()[row]);
+    case ColumnType::String:
+        return string(row);
+    case ColumnType::Json:
+        return values<json>()[row];
+    case ColumnType::Empty:
+        break;
+    }
+    return json();
+}
+
+bool Column::isNull(size_t row) const
+{
+    if (type() == ColumnType::Json) {
+        return values<json>()[row].is_null();
+    }
+    return _nulls.size() != 0 && _nulls.test(row);
+}
+
+const Bitmap* Column::nulls() const
+{
+    return _nulls.size() != 0 ? &_nulls : nullptr;
+}
+
+std::string_view Column::string(size_t row) const
+{
+    return std::get<StringBuffer>(_data)[row];
+}
+
+const StringBuffer& Column::strings() const
+{
+    return std::get<StringBuffer>(_data);
+}
+
+bool Column::encodeDictionary(size_t maxDictionarySize)
+{
+    assert(type() == ColumnType::String);
+    return mutableStrings().encode(maxDictionarySize);
+}
+
+Column Column::take(std::span<const size_t> rows) const
+{
+    Column result(type());
+    switch (type()) {
+    case ColumnType::Int:
+        gather(values<int64_t>(), rows, result.mutableValues<int64_t>());
+        break;
+    case ColumnType::Double:
+        gather(values<double>(), rows, result.mutableValues<double>());
+        break;
+    case ColumnType::Bool:
+        gather(values<uint8_t>(), rows, result.mutableValues<uint8_t>());
+        break;
+    case ColumnType::String:
+        result.mutableStrings() = strings().take(rows);
+        break;
+    case ColumnType::Json:
+        gather(values<json>(), rows, result.mutableValues<json>());
+        result._hasOnlyNulls = _hasOnlyNulls;
+        break;
+    case ColumnType::Empty:
+        break;
+    }
+    if (_nulls.size() != 0) {
+        Bitmap nulls(rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (_nulls.test(rows[i])) {
+                nulls.set(i);
+            }
+        }
+        if (nulls.count() != 0) {
+            result._nulls = std::move(nulls);
+        }
+    }
+    result.updateZoneMap();
+    return result;
+}
+
+const ZoneMap& Column::zoneMap() const
+{
+    return _zoneMap;
+}
+
+size_t Column::memoryUsage() const
+{
+    const size_t valuesSize = std::visit([](const auto& values) -> size_t {
+        using Values = std::decay_t<decltype(values)>;
+        if constexpr (std::is_same_v<Values, std::monostate>) {
+            return 0;
+        } else if constexpr (std::is_same_v<Values, std::vector<json>>) {
+            size_t size = memory::vectorSize(values);
+            for (const auto& value : values) {
+                size += memory::jsonSize(value);
+            }
+            return size;
+        } else {
+            return values.memoryUsage();
+        }
+    },
+        _data);
+    return valuesSize + _zoneMap.memoryUsage() + _nulls.memoryUsage();
+}
+
+void Column::convertTo(ColumnType type)
+{
+    if (type == this->type()) {
+        return;
+    }
+
+    if (this->type() == ColumnType::Int && type == ColumnType::Double) {
+        const auto ints = values<int64_t>();
+        if (std::all_of(ints.begin(), ints.end(), isExactDouble)) {
+            _data = ColumnBuffer<double>(std::vector<double>(ints.begin(), ints.end()));
+            return;
+        }
+        type = ColumnType::Json;
+    }
+
+    if (type == ColumnType::Json) {
+        const bool hasOnlyNulls = _nulls.count() == size();
+        std::vector<json> values;
+        values.reserve(std::max(size(), _capacity));
+        for (size_t row = 0; row < size(); row++) {
+            values.push_back(get(row));
+        }
+        _data = std::move(values);
+        _nulls = Bitmap();
+        _hasOnlyNulls = hasOnlyNulls;
+        return;
+    }
+
+    // The column is either empty or a Json column of nulls, which become the null rows.
+    assert(this->type() == ColumnType::Empty || _hasOnlyNulls);
+    const size_t nullCount = size();
+    switch (type) {
+    case ColumnType::Int:
+        _data = ColumnBuffer<int64_t>(std::vector<int64_t>(nullCount));
+        break;
+    case ColumnType::Double:
+        _data = ColumnBuffer<double>(std::vector<double>(nullCount));
+        break;
+    case ColumnType::Bool:
+        _data = ColumnBuffer<uint8_t>(std::vector<uint8_t>(nullCount));
+        break;
+    case ColumnType::String:
+        _data = StringBuffer();
+        for (size_t row = 0; row < nullCount; row++) {
+            mutableStrings().push_back("");
+        }
+        break;
+    case ColumnType::Json:
+    case ColumnType::Empty:
+        break;
+    }
+    _nulls = nullCount == 0 ? Bitmap() : Bitmap(nullCount, true);
+    _hasOnlyNulls = false;
+    reserve(_capacity);
+}
+
+void Column::pushJson(json value)
+{
+    mutableValues<json>().push_back(std::move(value));
+    _hasOnlyNulls = false;
+}
+
+void Column::finishAppend()
+{
+    if (_nulls.size() != 0) {
+        _nulls.resize(size());
+    }
+    updateZoneMap();
+}
+
+void Column::updateZoneMap()
+{
+    if (type() == ColumnType::Int) {
+        _zoneMap.update(values<int64_t>());
+    } else if (type() == ColumnType::Double) {
+        _zoneMap.update(values<double>());
+    } else {
+        _zoneMap.clear();
+    }
+}
+
+template <typename T>
+std::vector<T>& Column::mutableValues()
+{
+    if constexpr (std::is_same_v<T, json>) {
+        return std::get<std::vector<json>>(_data);
+    } else {
+        return std::get<ColumnBuffer<T>>(_data).values();
+    }
+}
+
+StringBuffer& Column::mutableStrings()
+{
+    return std::get<StringBuffer>(_data);
+}
+
+}
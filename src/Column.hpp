@@ -0,0 +1,210 @@
+#pragma once
+#include "Bitmap.hpp"
+#include "ColumnBuffer.hpp"
+#include "ZoneMap.hpp"
+#include <cstdint>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace jdf {
+
+using json = nlohmann::json;
+
+/**
+ * The physical type of a column. Empty is the type of a column that has not seen any value yet, Json is
+ * the fallback for columns with mixed or nested values.
+ * @note The order has to match the alternatives of Column::Storage.
+ */
+enum class ColumnType {
+    Empty,
+    Int,
+    Double,
+    Bool,
+    String,
+    Json,
+};
+
+/**
+ * A single contiguous, typed column of a DataFrame.
+ * The type is inferred from the first value that is added. Integer columns are widened to Double when a
+ * floating point value is added, unless one of the integers has no exact double, any other mismatch turns
+ * the column into a Json column.
+ * Nulls keep the type: Int, Double, Bool and String columns have a bitmap of their null rows, which hold
+ * a zero value (0, 0.0, false or "") in the typed storage. Nulls added before the first value are kept in
+ * a Json column, which takes the type of the first value that follows.
+ */
+class Column {
+public:
+    using Storage = std::variant<std::monostate,
+        ColumnBuffer<int64_t>,
+        ColumnBuffer<double>,
+        ColumnBuffer<uint8_t>,
+        StringBuffer,
+        std::vector<json>>;
+
+    Column() = default;
+    explicit Column(const json& values);
+    explicit Column(Storage data);
+
+    /**
+     * Constructs a column from storage, its precomputed zone map and its null rows, see nulls(). Only Int
+     * and Double columns have a zone map.
+     */
+    Column(Storage data, ZoneMap zoneMap, Bitmap nulls = Bitmap());
+
+    /**
+     * Constructs an empty column of the given type.
+     */
+    explicit Column(ColumnType type);
+
+    ColumnType type() const;
+    size_t size() const;
+
+    void push_back(const json& value);
+
+    /**
+     * Moves Json values instead of copying them.
+     */
+    void push_back(json&& value);
+
+    /**
+     * Typed variants of push_back, which apply the same type promotion without going through json.
+     */
+    void addInt(int64_t value);
+    void addDouble(double value);
+    void addBool(bool value);
+    void addString(std::string_view value);
+    void addNull();
+
+    /**
+     * Reserves memory for the given number of values. For an Empty column the memory is reserved once the
+     * type is known.
+     */
+    void reserve(size_t size);
+
+    /**
+     * Appends all values of another column, widening the type of this column if needed.
+     */
+    void append(const Column& other);
+
+    /**
+     * Returns the value at the given row as a json value.
+     */
+    json get(size_t row) const;
+
+    bool isNull(size_t row) const;
+
+    /**
+     * Returns the null rows of an Int, Double, Bool or String column, or nullptr if it has none. Json
+     * columns store their nulls as json values.
+     */
+    const Bitmap* nulls() const;
+
+    /**
+     * Returns the raw values of an Int (int64_t), Double (double) or Bool (uint8_t) column, including the
+     * zero values of null rows.
+     */
+    template <typename T>
+    std::span<const T> values() const
+    {
+        if constexpr (std::is_same_v<T, json>) {
+            return std::get<std::vector<json>>(_data);
+        } else {
+            return std::get<ColumnBuffer<T>>(_data).span();
+        }
+    }
+    std::string_view string(size_t row) const;
+
+    /**
+     * Returns the values of a String column.
+     */
+    const StringBuffer& strings() const;
+
+    /**
+     * Dictionary encodes a String column, unless it has more than maxDictionarySize distinct values.
+     * Values added later are encoded as well. Returns whether the column is dictionary encoded.
+     */
+    bool encodeDictionary(size_t maxDictionarySize = std::numeric_limits<uint32_t>::max());
+
+    /**
+     * Returns the value at the given row converted to T. Numbers and strings are read directly from the
+     * typed storage, everything else is converted through json.
+     */
+    template <typename T>
+    T value(size_t row) const
+    {
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            return string(row);
+        } else {
+            if (_nulls.size() != 0 && _nulls.test(row)) {
+                return json().template get<T>();
+            }
+            if constexpr (std::is_arithmetic_v<T>) {
+                switch (type()) {
+                case ColumnType::Int:
+                    return static_cast<T>(values<int64_t>()[row]);
+                case ColumnType::Double:
+                    return static_cast<T>(values<double>()[row]);
+                case ColumnType::Bool:
+                    return static_cast<T>(values<uint8_t>()[row]);
+                default:
+                    break;
+                }
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                if (type() == ColumnType::String) {
+                    return std::string(string(row));
+                }
+            }
+            return get(row).template get<T>();
+        }
+    }
+
+    /**
+     * Returns a new column of the same type containing the given rows, in the given order.
+     */
+    Column take(std::span<const size_t> rows) const;
+
+    /**
+     * Returns the block bounds of an Int or Double column, which are kept up to date as values are added.
+     */
+    const ZoneMap& zoneMap() const;
+
+    /**
+     * Returns the heap memory of the values and the zone map, including allocator overhead. Views of a
+     * memory mapped file take no heap memory.
+     */
+    size_t memoryUsage() const;
+
+private:
+    /**
+     * Widens the column so that it can hold a value of the given type and returns the resulting type.
+     */
+    ColumnType prepareFor(ColumnType valueType);
+    void convertTo(ColumnType type);
+    void pushJson(json value);
+
+    /**
+     * Extends the null rows and the zone map over the values that have been appended.
+     */
+    void finishAppend();
+    void updateZoneMap();
+    template <typename T>
+    std::vector<T>& mutableValues();
+    StringBuffer& mutableStrings();
+
+    Storage _data;
+    ZoneMap _zoneMap;
+    // Empty unless a typed row is null.
+    Bitmap _nulls;
+    // Whether all values of a Json column are null, so that it can still take the type of the next value.
+    bool _hasOnlyNulls = false;
+    size_t _capacity = 0;
+};
+
+}
@@ -0,0 +1,206 @@
+#include "ColumnBuffer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace jdf {
+
+uint32_t StringDictionary::add(std::string_view value)
+{
+    if (const auto code = find(value)) {
+        return *code;
+    }
+    assert(values.size() < std::numeric_limits<uint32_t>::max());
+    const auto code = static_cast<uint32_t>(values.size());
+    values.emplace_back(value);
+    codes.emplace(values.back(), code);
+    return code;
+}
+
+std::optional<uint32_t> StringDictionary::find(std::string_view value) const
+{
+    const auto it = codes.find(value);
+    if (it == codes.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+size_t StringDictionary::memoryUsage() const
+{
+    size_t size = memory::vectorSize(values) + memory::hashMapSize(codes);
+    for (const auto& value : values) {
+        size += 2 * memory::stringSize(value);
+    }
+    return size;
+}
+
+StringBuffer::StringBuffer(const std::vector<std::string>& values)
+{
+    size_t characterCount = 0;
+    for (const auto& value : values) {
+        characterCount += value.size();
+    }
+    _arena.reserve(characterCount);
+    _arenaOffsets.reserve(values.size() + 1);
+    for (const auto& value : values) {
+        push_back(value);
+    }
+}
+
+StringBuffer::StringBuffer(std::span<const uint64_t> offsets, const char* characters, std::shared_ptr<const void> owner)
+    : _offsets(offsets)
+    , _characters(characters)
+    , _owner(std::move(owner))
+{
+}
+
+StringBuffer::StringBuffer(std::vector<uint32_t> codes, std::shared_ptr<StringDictionary> dictionary)
+    : _codes(std::move(codes))
+    , _dictionary(std::move(dictionary))
+{
+    assert(_dictionary != nullptr);
+}
+
+size_t StringBuffer::size() const
+{
+    if (isView()) {
+        return _offsets.size() - 1;
+    }
+    return isDictionary() ? _codes.size() : _arenaOffsets.size() - 1;
+}
+
+bool StringBuffer::isView() const
+{
+    return _owner != nullptr;
+}
+
+bool StringBuffer::isDictionary() const
+{
+    return _dictionary != nullptr;
+}
+
+std::string_view StringBuffer::operator[](size_t index) const
+{
+    if (isView()) {
+        return std::string_view(_characters + _offsets[index], _offsets[index + 1] - _offsets[index]);
+    }
+    if (isDictionary()) {
+        return _dictionary->values[_codes[index]];
+    }
+    return std::string_view(_arena.data() + _arenaOffsets[index], _arenaOffsets[index + 1] - _arenaOffsets[index]);
+}
+
+void StringBuffer::push_back(std::string_view value)
+{
+    if (isDictionary()) {
+        const auto code = _dictionary->find(value);
+        _codes.push_back(code ? *code : mutableDictionary().add(value));
+        return;
+    }
+    if (isView()) {
+        makeArena();
+    }
+    _arena.append(value);
+    _arenaOffsets.push_back(_arena.size());
+}
+
+void StringBuffer::reserve(size_t size)
+{
+    if (isDictionary()) {
+        _codes.reserve(size);
+        return;
+    }
+    if (isView()) {
+        makeArena();
+    }
+    _arenaOffsets.reserve(size + 1);
+}
+
+bool StringBuffer::encode(size_t maxDictionarySize)
+{
+    if (isDictionary()) {
+        return true;
+    }
+    auto dictionary = std::make_shared<StringDictionary>();
+    // The codes are only reserved for all rows once the first rows fit the dictionary, so that columns with
+    // only distinct values give up before allocating them.
+    const size_t probeSize = std::min(size(), maxDictionarySize + 1);
+    std::vector<uint32_t> codes;
+    codes.reserve(probeSize);
+    for (size_t i = 0; i < size(); i++) {
+        codes.push_back(dictionary->add((*this)[i]));
+        if (dictionary->values.size() > maxDictionarySize) {
+            return false;
+        }
+        if (codes.size() == probeSize) {
+            codes.reserve(size());
+        }
+    }
+    *this = StringBuffer(std::move(codes), std::move(dictionary));
+    return true;
+}
+
+StringBuffer StringBuffer::take(std::span<const size_t> rows) const
+{
+    if (isDictionary()) {
+        std::vector<uint32_t> codes;
+        codes.reserve(rows.size());
+        for (const size_t row : rows) {
+            codes.push_back(_codes[row]);
+        }
+        return StringBuffer(std::move(codes), _dictionary);
+    }
+    StringBuffer result;
+    size_t characterCount = 0;
+    for (const size_t row : rows) {
+        characterCount += (*this)[row].size();
+    }
+    result._arena.reserve(characterCount);
+    result._arenaOffsets.reserve(rows.size() + 1);
+    for (const size_t row : rows) {
+        result.push_back((*this)[row]);
+    }
+    return result;
+}
+
+size_t StringBuffer::memoryUsage() const
+{
+    if (isDictionary()) {
+        return memory::vectorSize(_codes) + _dictionary->memoryUsage();
+    }
+    return memory::vectorSize(_arenaOffsets) + memory::stringSize(_arena);
+}
+
+std::span<const uint32_t> StringBuffer::codes() const
+{
+    assert(isDictionary());
+    return _codes;
+}
+
+const StringDictionary& StringBuffer::dictionary() const
+{
+    assert(isDictionary());
+    return *_dictionary;
+}
+
+void StringBuffer::makeArena()
+{
+    StringBuffer arena;
+    const size_t count = size();
+    arena._arenaOffsets.reserve(count + 1);
+    for (size_t i = 0; i < count; i++) {
+        arena.push_back((*this)[i]);
+    }
+    *this = std::move(arena);
+}
+
+StringDictionary& StringBuffer::mutableDictionary()
+{
+    if (_dictionary.use_count() > 1) {
+        _dictionary = std::make_shared<StringDictionary>(*_dictionary);
+    }
+    return *_dictionary;
+}
+
+}
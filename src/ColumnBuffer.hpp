@@ -0,0 +1,167 @@
+#pragma once
+#include "MemoryUsage.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * Hash that allows looking up std::string keys by std::string_view without constructing a string.
+ */
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const
+    {
+        return std::hash<std::string_view> {}(str);
+    }
+};
+
+/**
+ * The distinct values of a dictionary encoded string column, code i standing for values[i].
+ */
+struct StringDictionary {
+    std::vector<std::string> values;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> codes;
+
+    /**
+     * Returns the code of value, adding value to the dictionary if needed.
+     */
+    uint32_t add(std::string_view value);
+    std::optional<uint32_t> find(std::string_view value) const;
+    size_t memoryUsage() const;
+};
+
+/**
+ * The values of a column, either owned or viewed in memory that is kept alive by an owner, e.g. a memory
+ * mapped file. Views are read-only, they are copied into owned memory on the first modification.
+ */
+template <typename T>
+class ColumnBuffer {
+public:
+    ColumnBuffer() = default;
+    explicit ColumnBuffer(std::vector<T> values)
+        : _values(std::move(values))
+    {
+    }
+    ColumnBuffer(std::span<const T> view, std::shared_ptr<const void> owner)
+        : _view(view)
+        , _owner(std::move(owner))
+    {
+    }
+
+    size_t size() const
+    {
+        return isView() ? _view.size() : _values.size();
+    }
+    bool isView() const
+    {
+        return _owner != nullptr;
+    }
+    std::span<const T> span() const
+    {
+        return isView() ? _view : std::span<const T>(_values);
+    }
+    const T& operator[](size_t index) const
+    {
+        return span()[index];
+    }
+
+    /**
+     * Returns the heap memory of the owned values. Views take no heap memory.
+     */
+    size_t memoryUsage() const
+    {
+        return memory::vectorSize(_values);
+    }
+
+    /**
+     * Returns the owned values for modification.
+     */
+    std::vector<T>& values()
+    {
+        if (isView()) {
+            _values.assign(_view.begin(), _view.end());
+            _view = {};
+            _owner.reset();
+        }
+        return _values;
+    }
+
+private:
+    std::vector<T> _values;
+    std::span<const T> _view;
+    std::shared_ptr<const void> _owner;
+};
+
+/**
+ * The values of a string column, which are stored in one of three ways:
+ * - owned, in an arena: the characters of all values in one buffer and size() + 1 offsets into it, the
+ *   value of row i being the characters between offsets[i] and offsets[i + 1]. Adding a value does not
+ *   allocate memory per value.
+ * - a view of offsets and characters in the same layout, in memory that is kept alive by an owner,
+ * - dictionary encoded, i.e. one 32 bit code per row into a dictionary of the distinct values. Dictionaries
+ *   are shared by the buffers taken from the same column and copied when a shared dictionary grows.
+ * Views are copied into an arena when a value is added. Dictionary encoded buffers stay encoded, values
+ * that are not in the dictionary yet are added to it.
+ */
+class StringBuffer {
+public:
+    StringBuffer() = default;
+    explicit StringBuffer(const std::vector<std::string>& values);
+    StringBuffer(std::span<const uint64_t> offsets, const char* characters, std::shared_ptr<const void> owner);
+    StringBuffer(std::vector<uint32_t> codes, std::shared_ptr<StringDictionary> dictionary);
+
+    size_t size() const;
+    bool isView() const;
+    bool isDictionary() const;
+    std::string_view operator[](size_t index) const;
+
+    void push_back(std::string_view value);
+    void reserve(size_t size);
+
+    /**
+     * Dictionary encodes the values, unless there are more than maxDictionarySize distinct values.
+     * Returns whether the buffer is dictionary encoded.
+     */
+    bool encode(size_t maxDictionarySize);
+
+    /**
+     * Returns a new buffer containing the given rows, which shares the dictionary of this buffer.
+     */
+    StringBuffer take(std::span<const size_t> rows) const;
+
+    /**
+     * Returns the heap memory of the arena, or of the codes and the whole dictionary, which may be shared
+     * with other buffers.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * Returns the codes and the dictionary of a dictionary encoded buffer.
+     */
+    std::span<const uint32_t> codes() const;
+    const StringDictionary& dictionary() const;
+
+private:
+    /**
+     * Copies the values of a view into an arena.
+     */
+    void makeArena();
+    StringDictionary& mutableDictionary();
+
+    std::vector<uint64_t> _arenaOffsets = { 0 };
+    std::string _arena;
+    std::span<const uint64_t> _offsets;
+    const char* _characters = nullptr;
+    std::shared_ptr<const void> _owner;
+    std::vector<uint32_t> _codes;
+    std::shared_ptr<StringDictionary> _dictionary;
+};
+
+}
@@ -0,0 +1,110 @@
+#include "CsvBatchReader.hpp"
+#include <cassert>
+
+namespace jdf {
+
+CsvBatchReader::CsvBatchReader(std::istream& stream, size_t batchSize, std::string_view delimiter)
+    : _stream(stream)
+    , _batchSize(batchSize)
+    , _delimiter(delimiter)
+    , _blocks(_stream)
+{
+    readHeader();
+}
+
+CsvBatchReader::CsvBatchReader(std::string_view path, size_t batchSize, std::string_view delimiter)
+    : _file(std::make_unique<std::ifstream>(std::string { path }, std::ios::binary))
+    , _stream(*_file)
+    , _batchSize(batchSize)
+    , _delimiter(delimiter)
+    , _blocks(_stream)
+{
+    assert(_file->is_open());
+    readHeader();
+}
+
+CsvBatchReader::~CsvBatchReader() = default;
+
+const std::vector<std::string>& CsvBatchReader::columnNames() const
+{
+    return _columnNames;
+}
+
+std::optional<DataFrame> CsvBatchReader::next()
+{
+    if (_columnNames.empty()) {
+        return std::nullopt;
+    }
+
+    scanRecords(_batchSize);
+    while (_recordCount < _batchSize && readBlock()) {
+        scanRecords(_batchSize);
+    }
+    // At the end of the input the last record does not need to be terminated by a line break.
+    const size_t end = _recordCount < _batchSize ? _buffer.size() : _recordEnd;
+
+    std::vector<Column> columns;
+    columns.reserve(_columnNames.size());
+    for (size_t column = 0; column < _columnNames.size(); column++) {
+        columns.emplace_back(_columnTypes.empty() ? ColumnType::Empty : _columnTypes[column]);
+    }
+    csv::parseRecords(std::string_view(_buffer).substr(_begin, end - _begin), _delimiter, columns);
+
+    _begin = _scanPosition = _recordEnd = end;
+    _recordCount = 0;
+    _quoteState = csv::QuoteState::Unquoted;
+
+    if (columns[0].size() == 0) {
+        return std::nullopt;
+    }
+    if (_columnTypes.empty()) {
+        for (const auto& column : columns) {
+            _columnTypes.push_back(column.type());
+        }
+    }
+    return DataFrame(_columnNames, std::move(columns));
+}
+
+void CsvBatchReader::readHeader()
+{
+    assert(_batchSize > 0);
+    scanRecords(1);
+    while (_recordCount == 0 && readBlock()) {
+        scanRecords(1);
+    }
+
+    const size_t end = _recordCount == 0 ? _buffer.size() : _recordEnd;
+    std::string_view header = std::string_view(_buffer).substr(0, end);
+    _columnNames = csv::parseHeader(header, _delimiter);
+    _begin = _scanPosition = _recordEnd = end;
+    _recordCount = 0;
+}
+
+bool CsvBatchReader::readBlock()
+{
+    const auto dropped = _blocks.appendTo(_buffer, _begin);
+    if (!dropped) {
+        return false;
+    }
+    _begin -= *dropped;
+    _scanPosition -= *dropped;
+    _recordEnd -= *dropped;
+    return true;
+}
+
+void CsvBatchReader::scanRecords(size_t maxRecords)
+{
+    while (_scanPosition < _buffer.size() && _recordCount < maxRecords) {
+        const size_t lineBreak = csv::findRecordEnd(_buffer, _scanPosition, _buffer.size(), _delimiter, _quoteState);
+        if (lineBreak == std::string_view::npos) {
+            _scanPosition = _buffer.size();
+            return;
+        }
+        // Empty lines are skipped by parseRecords and don't count as records.
+        const size_t lineSize = lineBreak - _recordEnd;
+        _recordCount += lineSize > 1 || (lineSize == 1 && _buffer[_recordEnd] != '\r');
+        _recordEnd = _scanPosition = lineBreak + 1;
+    }
+}
+
+}
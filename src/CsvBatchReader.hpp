@@ -0,0 +1,69 @@
+#pragma once
+#include "BlockReader.hpp"
+#include "CsvReader.hpp"
+#include "DataFrame.hpp"
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * Reads a csv document in batches of a fixed number of rows, so that documents larger than the available
+ * memory can be processed one DataFrame at a time.
+ * The column names are taken from the header. Column types are taken from the first batch and later
+ * batches start from the same types, they are only widened when a value does not fit.
+ * The next block of the input is read in the background while a batch is parsed and processed.
+ */
+class CsvBatchReader {
+public:
+    CsvBatchReader(std::istream& stream, size_t batchSize, std::string_view delimiter = ",");
+    CsvBatchReader(std::string_view path, size_t batchSize, std::string_view delimiter = ",");
+    ~CsvBatchReader();
+
+    CsvBatchReader(const CsvBatchReader&) = delete;
+    CsvBatchReader(CsvBatchReader&&) = delete;
+    CsvBatchReader& operator=(const CsvBatchReader&) = delete;
+    CsvBatchReader& operator=(CsvBatchReader&&) = delete;
+
+    const std::vector<std::string>& columnNames() const;
+
+    /**
+     * Returns the next batch of at most batchSize rows, or std::nullopt when the input is exhausted.
+     */
+    std::optional<DataFrame> next();
+
+private:
+    void readHeader();
+
+    /**
+     * Appends the next block of the input to the buffer. Returns false at the end of the input.
+     */
+    bool readBlock();
+
+    /**
+     * Advances the scan position over complete records until maxRecords records have been found or the
+     * buffer is exhausted.
+     */
+    void scanRecords(size_t maxRecords);
+
+    std::unique_ptr<std::ifstream> _file;
+    std::istream& _stream;
+    size_t _batchSize;
+    std::string _delimiter;
+    std::vector<std::string> _columnNames;
+    std::vector<ColumnType> _columnTypes;
+    BlockReader _blocks;
+
+    std::string _buffer;
+    size_t _begin = 0;
+    size_t _scanPosition = 0;
+    size_t _recordEnd = 0;
+    size_t _recordCount = 0;
+    csv::QuoteState _quoteState = csv::QuoteState::Unquoted;
+};
+
+}
@@ -0,0 +1,366 @@
+#include "CsvReader.hpp"
+#include "DataFrame.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+
+namespace jdf::csv {
+
+namespace {
+    constexpr size_t minimumChunkSize = 1 << 20;
+    constexpr size_t maxDictionaryFraction = 4;
+    constexpr size_t maxDictionarySize = 1 << 12;
+
+    struct Field {
+        std::string_view value;
+        bool quoted;
+    };
+
+    bool atDelimiter(const char* it, const char* end, std::string_view delimiter)
+    {
+        return *it == delimiter[0] && (delimiter.size() == 1 || std::string_view(it, end - it).starts_with(delimiter));
+    }
+
+    /**
+     * Reads the field starting at it and returns the position of the delimiter, line break or end that
+     * terminates it. Escaped quotes in quoted fields are resolved into scratch, which then backs the value.
+     */
+    const char* readField(const char* it, const char* end, std::string_view delimiter, std::string& scratch, Field& field)
+    {
+        if (it == end || *it != '"') {
+            const char* begin = it;
+            while (it < end && *it != '\n' && !atDelimiter(it, end, delimiter)) {
+                it++;
+            }
+            const char* valueEnd = (it > begin && it[-1] == '\r') ? it - 1 : it;
+            field = { std::string_view(begin, valueEnd - begin), false };
+            return it;
+        }
+
+        it++;
+        const char* segment = it;
+        bool isEscaped = false;
+        scratch.clear();
+        while (true) {
+            const char* quote = static_cast<const char*>(std::memchr(it, '"', end - it));
+            if (quote == nullptr) {
+                quote = end;
+            }
+            if (quote != end && quote + 1 != end && quote[1] == '"') {
+                scratch.append(segment, quote + 1);
+                it = segment = quote + 2;
+                isEscaped = true;
+                continue;
+            }
+            if (isEscaped) {
+                scratch.append(segment, quote);
+                field = { scratch, true };
+            } else {
+                field = { std::string_view(segment, quote - segment), true };
+            }
+            it = quote == end ? end : quote + 1;
+            break;
+        }
+        while (it < end && *it != '\n' && !atDelimiter(it, end, delimiter)) {
+            it++;
+        }
+        return it;
+    }
+
+    /**
+     * Reads one record and calls visit(index, field) for each of its fields. Returns the start of the next
+     * record.
+     */
+    template <typename Visitor>
+    const char* readRecord(const char* it, const char* end, std::string_view delimiter, std::string& scratch, Visitor&& visit)
+    {
+        size_t index = 0;
+        while (true) {
+            Field field;
+            it = readField(it, end, delimiter, scratch, field);
+            visit(index++, field);
+            if (it == end || *it == '\n') {
+                break;
+            }
+            it += delimiter.size();
+        }
+        return it == end ? end : it + 1;
+    }
+
+    /**
+     * Matches the json number grammar, so that e.g. zero padded ids and "1." stay strings.
+     */
+    bool isNumber(std::string_view token)
+    {
+        size_t i = 0;
+        const auto isDigit = [&] { return i < token.size() && std::isdigit(static_cast<unsigned char>(token[i])); };
+        const auto skipDigits = [&] {
+            const size_t begin = i;
+            while (isDigit()) {
+                i++;
+            }
+            return i > begin;
+        };
+        if (i < token.size() && token[i] == '-') {
+            i++;
+        }
+        if (i < token.size() && token[i] == '0') {
+            i++;
+        } else if (!skipDigits()) {
+            return false;
+        }
+        if (i < token.size() && token[i] == '.') {
+            i++;
+            if (!skipDigits()) {
+                return false;
+            }
+        }
+        if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+            i++;
+            if (i < token.size() && (token[i] == '+' || token[i] == '-')) {
+                i++;
+            }
+            if (!skipDigits()) {
+                return false;
+            }
+        }
+        return i == token.size();
+    }
+
+    std::string_view trimSpaces(std::string_view token)
+    {
+        constexpr std::string_view spaces = " \t";
+        const size_t begin = token.find_first_not_of(spaces);
+        if (begin == std::string_view::npos) {
+            return {};
+        }
+        return token.substr(begin, token.find_last_not_of(spaces) + 1 - begin);
+    }
+
+    /**
+     * Appends an unquoted field. Spaces and tabs around numbers, booleans and null are ignored, other
+     * fields are strings as written.
+     */
+    void addValue(Column& column, std::string_view field)
+    {
+        const std::string_view token = trimSpaces(field);
+        if (isNumber(token)) {
+            const char* end = token.data() + token.size();
+            int64_t intValue;
+            if (const auto result = std::from_chars(token.data(), end, intValue); result.ec == std::errc() && result.ptr == end) {
+                column.addInt(intValue);
+                return;
+            }
+            double doubleValue;
+            if (const auto result = std::from_chars(token.data(), end, doubleValue); result.ec == std::errc() && result.ptr == end) {
+                column.addDouble(doubleValue);
+                return;
+            }
+        }
+        if (token == "true" || token == "false") {
+            column.addBool(token == "true");
+        } else if (token == "null") {
+            column.push_back(json());
+        } else {
+            column.addString(field);
+        }
+    }
+
+    /**
+     * Dictionary encodes the String columns with at most one distinct value per maxDictionaryFraction rows
+     * and at most maxDictionarySize distinct values, e.g. categorical columns. The attempt stops at the
+     * first distinct value above the limit, which bounds the work spent on columns that are not encoded.
+     */
+    void encodeDictionaries(std::vector<Column>& columns)
+    {
+        ThreadPool::global().run(columns.size(), [&](size_t column) {
+            if (columns[column].type() == ColumnType::String) {
+                columns[column].encodeDictionary(std::min(columns[column].size() / maxDictionaryFraction, maxDictionarySize));
+            }
+        });
+    }
+
+    DataFrame makeDataFrame(std::vector<std::string> columnNames, std::vector<Column> columns, ProfileScope& profile)
+    {
+        profile.stage("encode");
+        encodeDictionaries(columns);
+        DataFrame dataFrame(std::move(columnNames), std::move(columns));
+        profile.rows(dataFrame.size(), dataFrame.size());
+        return dataFrame;
+    }
+
+    constexpr size_t quoteStateCount = 3;
+
+    struct QuoteScan {
+        QuoteState state = QuoteState::Unquoted;
+        size_t firstRecordEnd = std::string_view::npos;
+    };
+
+    /**
+     * Returns whether a delimiter can overlap with itself, e.g. "::" in ":::". For other delimiters, a
+     * delimiter right before a position outside of quotes always terminates the previous field.
+     */
+    bool isSelfOverlapping(std::string_view delimiter)
+    {
+        for (size_t size = 1; size < delimiter.size(); size++) {
+            if (delimiter.starts_with(delimiter.substr(delimiter.size() - size))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isFieldStart(std::string_view text, size_t position, std::string_view delimiter)
+    {
+        return position == 0 || text[position - 1] == '\n' || (position >= delimiter.size() && text.substr(position - delimiter.size(), delimiter.size()) == delimiter);
+    }
+
+    /**
+     * Follows the quote state through text[begin, end). Returns the state at end and the first line break
+     * that ends a record.
+     */
+    QuoteScan scanQuotes(std::string_view text, size_t begin, size_t end, std::string_view delimiter, QuoteState state)
+    {
+        QuoteScan scan;
+        scan.firstRecordEnd = findRecordEnd(text, begin, end, delimiter, state);
+        for (size_t recordEnd = scan.firstRecordEnd; recordEnd != std::string_view::npos;) {
+            recordEnd = findRecordEnd(text, recordEnd + 1, end, delimiter, state);
+        }
+        scan.state = state;
+        return scan;
+    }
+
+    bool isEmptyLine(const char* it, const char* end)
+    {
+        return *it == '\n' || (*it == '\r' && it + 1 < end && it[1] == '\n');
+    }
+}
+
+size_t findRecordEnd(std::string_view text, size_t begin, size_t end, std::string_view delimiter, QuoteState& state)
+{
+    for (size_t position = begin; position < end; position++) {
+        const char character = text[position];
+        if (state == QuoteState::QuoteInQuoted) {
+            if (character == '"') {
+                state = QuoteState::Quoted;
+                continue;
+            }
+            state = QuoteState::Unquoted;
+        }
+        if (state == QuoteState::Quoted) {
+            if (character == '"') {
+                state = QuoteState::QuoteInQuoted;
+            }
+        } else if (character == '\n') {
+            return position;
+        } else if (character == '"' && isFieldStart(text, position, delimiter)) {
+            state = QuoteState::Quoted;
+        }
+    }
+    return std::string_view::npos;
+}
+
+std::vector<std::string> parseHeader(std::string_view& text, std::string_view delimiter)
+{
+    std::vector<std::string> columnNames;
+    if (text.empty()) {
+        return columnNames;
+    }
+    std::string scratch;
+    const char* next = readRecord(text.data(), text.data() + text.size(), delimiter, scratch, [&](size_t, const Field& field) {
+        columnNames.emplace_back(field.value);
+    });
+    text.remove_prefix(next - text.data());
+    return columnNames;
+}
+
+void parseRecords(std::string_view text, std::string_view delimiter, std::vector<Column>& columns)
+{
+    std::string scratch;
+    const char* it = text.data();
+    const char* end = it + text.size();
+    while (it < end) {
+        if (isEmptyLine(it, end)) {
+            it += *it == '\n' ? 1 : 2;
+            continue;
+        }
+        size_t fieldCount = 0;
+        it = readRecord(it, end, delimiter, scratch, [&](size_t index, const Field& field) {
+            if (index < columns.size()) {
+                if (field.quoted) {
+                    columns[index].addString(field.value);
+                } else {
+                    addValue(columns[index], field.value);
+                }
+            }
+            fieldCount = index + 1;
+        });
+        for (size_t index = fieldCount; index < columns.size(); index++) {
+            columns[index].push_back(json());
+        }
+    }
+}
+
+DataFrame parse(std::string_view text, std::string_view delimiter)
+{
+    assert(!delimiter.empty());
+    ProfileScope profile("fromCsv");
+    profile.stage("parse");
+    profile.bytes(text.size(), 0);
+    std::vector<std::string> columnNames = parseHeader(text, delimiter);
+    ThreadPool& pool = ThreadPool::global();
+    const bool canSplit = delimiter.find_first_of("\"\n") == std::string_view::npos && !isSelfOverlapping(delimiter);
+    const size_t chunkCount = canSplit ? std::clamp<size_t>(text.size() / minimumChunkSize, 1, pool.threadCount() * 4) : 1;
+    if (chunkCount == 1) {
+        std::vector<Column> columns(columnNames.size());
+        parseRecords(text, delimiter, columns);
+        return makeDataFrame(std::move(columnNames), std::move(columns), profile);
+    }
+
+    // Chunks have to start at a record boundary, i.e. at a line break outside of quoted fields. The quote
+    // state at the start of a range is only known once the ranges before it have been scanned, so every
+    // range is scanned from each possible state in parallel and the results are chained afterwards.
+    const size_t rawChunkSize = text.size() / chunkCount;
+    std::vector<std::array<QuoteScan, quoteStateCount>> scans(chunkCount);
+    pool.run(chunkCount, [&](size_t chunk) {
+        const size_t begin = chunk * rawChunkSize;
+        const size_t end = chunk + 1 == chunkCount ? text.size() : begin + rawChunkSize;
+        for (size_t state = 0; state < quoteStateCount; state++) {
+            scans[chunk][state] = scanQuotes(text, begin, end, delimiter, static_cast<QuoteState>(state));
+        }
+    });
+
+    std::vector<QuoteState> states(chunkCount, QuoteState::Unquoted);
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        states[chunk] = scans[chunk - 1][static_cast<size_t>(states[chunk - 1])].state;
+    }
+    std::vector<size_t> boundaries(chunkCount + 1, text.size());
+    boundaries[0] = 0;
+    for (size_t chunk = chunkCount - 1; chunk > 0; chunk--) {
+        const size_t recordEnd = scans[chunk][static_cast<size_t>(states[chunk])].firstRecordEnd;
+        boundaries[chunk] = recordEnd == std::string_view::npos ? boundaries[chunk + 1] : recordEnd + 1;
+    }
+
+    std::vector<std::vector<Column>> chunks(chunkCount, std::vector<Column>(columnNames.size()));
+    pool.run(chunkCount, [&](size_t chunk) {
+        parseRecords(text.substr(boundaries[chunk], boundaries[chunk + 1] - boundaries[chunk]), delimiter, chunks[chunk]);
+    });
+
+    profile.stage("merge");
+    std::vector<Column> columns(columnNames.size());
+    pool.run(columns.size(), [&](size_t column) {
+        columns[column] = std::move(chunks[0][column]);
+        for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+            columns[column].append(chunks[chunk][column]);
+            chunks[chunk][column] = Column();
+        }
+    });
+    return makeDataFrame(std::move(columnNames), std::move(columns), profile);
+}
+
+}
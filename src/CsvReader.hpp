@@ -0,0 +1,54 @@
+#pragma once
+#include "Column.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jdf {
+
+class DataFrame;
+
+namespace csv {
+
+    /**
+     * Whether a position lies in an unquoted field, in a quoted field, or right after a quote in a quoted
+     * field, which either closes the field or is the first half of an escaped quote.
+     */
+    enum class QuoteState {
+        Unquoted,
+        Quoted,
+        QuoteInQuoted,
+    };
+
+    /**
+     * Follows the quote state through text[begin, end) like parseRecords does: a quote only opens a quoted
+     * field at the start of a field. Returns the position of the first line break that ends a record, or
+     * std::string_view::npos if there is none. The state is updated up to that line break or to end.
+     * text before begin is only read to find the start of a field.
+     */
+    size_t findRecordEnd(std::string_view text, size_t begin, size_t end, std::string_view delimiter, QuoteState& state);
+
+    /**
+     * Parses the first record of text as column names and removes it from text.
+     */
+    std::vector<std::string> parseHeader(std::string_view& text, std::string_view delimiter);
+
+    /**
+     * Parses all records of text and appends their values to columns, one column per field.
+     * Quoted fields are always strings, unquoted fields are parsed as json numbers, booleans or null when
+     * possible, ignoring spaces and tabs around them.
+     * Records with fewer fields than columns are padded with nulls, fields beyond the last column are
+     * ignored.
+     */
+    void parseRecords(std::string_view text, std::string_view delimiter, std::vector<Column>& columns);
+
+    /**
+     * Parses a whole csv document. Large documents are split into chunks at record boundaries and the
+     * chunks are parsed in parallel on the global thread pool. String columns with few distinct values
+     * are dictionary encoded.
+     */
+    DataFrame parse(std::string_view text, std::string_view delimiter);
+
+}
+
+}
@@ -0,0 +1,163 @@
+#include "CsvWriter.hpp"
+#include "DataFrame.hpp"
+#include "Profiler.hpp"
+#include "TextFormat.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace jdf::csv {
+
+namespace {
+    constexpr size_t rowsPerRange = 1 << 16;
+    constexpr size_t flushSize = 1 << 20;
+
+    void appendQuoted(std::string_view value, std::string& out)
+    {
+        out += '"';
+        for (size_t quote = value.find('"'); quote != std::string_view::npos; quote = value.find('"')) {
+            out.append(value.substr(0, quote + 1));
+            out += '"';
+            value.remove_prefix(quote + 1);
+        }
+        out.append(value);
+        out += '"';
+    }
+
+    void appendJson(const json& value, std::string& out)
+    {
+        if (value.is_string()) {
+            appendQuoted(value.get_ref<const std::string&>(), out);
+        } else if (value.is_number_float()) {
+            textformat::appendDouble(value.get<double>(), out);
+        } else if (value.is_structured()) {
+            appendQuoted(value.dump(), out);
+        } else {
+            out += value.dump();
+        }
+    }
+
+    void appendValue(const Column& column, size_t row, std::string& out)
+    {
+        if (column.isNull(row)) {
+            out += "null";
+            return;
+        }
+        switch (column.type()) {
+        case ColumnType::Int:
+            textformat::appendNumber(column.values<int64_t>()[row], out);
+            break;
+        case ColumnType::Double:
+            textformat::appendDouble(column.values<double>()[row], out);
+            break;
+        case ColumnType::Bool:
+            out += column.values<uint8_t>()[row] ? "true" : "false";
+            break;
+        case ColumnType::String:
+            appendQuoted(column.string(row), out);
+            break;
+        case ColumnType::Json:
+            appendJson(column.values<json>()[row], out);
+            break;
+        case ColumnType::Empty:
+            break;
+        }
+    }
+
+    /**
+     * Appends the rows rowAt(begin), ..., rowAt(end - 1) of a DataFrame to out.
+     */
+    template <typename RowAt>
+    void formatRowsAt(const DataFrame& dataFrame, size_t begin, size_t end, RowAt rowAt, std::string_view delimiter, std::string& out)
+    {
+        const size_t columnCount = dataFrame.columnCount();
+        for (size_t i = begin; i < end; i++) {
+            const size_t row = rowAt(i);
+            for (size_t column = 0; column < columnCount; column++) {
+                appendValue(dataFrame.column(column), row, out);
+                if (column + 1 < columnCount) {
+                    out += delimiter;
+                }
+            }
+            out += '\n';
+        }
+    }
+
+    template <typename RowAt>
+    void writeRows(const DataFrame& dataFrame, size_t rowCount, RowAt rowAt, std::ostream& stream, std::string_view delimiter)
+    {
+        ProfileScope profile("toCsv");
+        profile.stage("write");
+        profile.rows(rowCount, rowCount);
+        size_t bytesWritten = 0;
+        const auto writeBuffer = [&](const std::string& buffer) {
+            stream.write(buffer.data(), buffer.size());
+            bytesWritten += buffer.size();
+        };
+
+        std::string buffer;
+        buffer.reserve(flushSize + flushSize / 4);
+        formatHeader(dataFrame, delimiter, buffer);
+
+        ThreadPool& pool = ThreadPool::global();
+        const size_t rangeCount = (rowCount + rowsPerRange - 1) / rowsPerRange;
+        if (pool.threadCount() == 1 || rangeCount <= 1) {
+            constexpr size_t rowsPerFormat = 1024;
+            for (size_t row = 0; row < rowCount; row += rowsPerFormat) {
+                formatRowsAt(dataFrame, row, std::min(row + rowsPerFormat, rowCount), rowAt, delimiter, buffer);
+                if (buffer.size() >= flushSize) {
+                    writeBuffer(buffer);
+                    buffer.clear();
+                }
+            }
+            writeBuffer(buffer);
+            profile.bytes(0, bytesWritten);
+            return;
+        }
+
+        writeBuffer(buffer);
+        const auto formatRange = [&](size_t begin, size_t end, std::string& out) {
+            formatRowsAt(dataFrame, begin, end, rowAt, delimiter, out);
+        };
+        textformat::formatInRanges(rowCount, rowsPerRange, formatRange, writeBuffer);
+        profile.bytes(0, bytesWritten);
+    }
+
+    size_t identity(size_t row)
+    {
+        return row;
+    }
+}
+
+void formatHeader(const DataFrame& dataFrame, std::string_view delimiter, std::string& out)
+{
+    const auto& columnNames = dataFrame.columnNames();
+    for (size_t column = 0; column < columnNames.size(); column++) {
+        const std::string& name = columnNames[column];
+        if (name.find_first_of("\"\r\n") != std::string::npos || name.find(delimiter) != std::string::npos) {
+            appendQuoted(name, out);
+        } else {
+            out += name;
+        }
+        if (column + 1 < columnNames.size()) {
+            out += delimiter;
+        }
+    }
+    out += '\n';
+}
+
+void formatRows(const DataFrame& dataFrame, size_t begin, size_t end, std::string_view delimiter, std::string& out)
+{
+    formatRowsAt(dataFrame, begin, end, identity, delimiter, out);
+}
+
+void write(const DataFrame& dataFrame, std::ostream& stream, std::string_view delimiter)
+{
+    writeRows(dataFrame, dataFrame.size(), identity, stream, delimiter);
+}
+
+void write(const DataFrame& dataFrame, std::span<const size_t> rows, std::ostream& stream, std::string_view delimiter)
+{
+    writeRows(dataFrame, rows.size(), [rows](size_t i) { return rows[i]; }, stream, delimiter);
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace jdf {
+
+class DataFrame;
+
+namespace csv {
+
+    /**
+     * Appends the header line of a DataFrame to out.
+     */
+    void formatHeader(const DataFrame& dataFrame, std::string_view delimiter, std::string& out);
+
+    /**
+     * Appends the rows [begin, end) of a DataFrame to out, one line per row.
+     * Numbers are formatted with std::to_chars, strings are always quoted.
+     */
+    void formatRows(const DataFrame& dataFrame, size_t begin, size_t end, std::string_view delimiter, std::string& out);
+
+    /**
+     * Writes a DataFrame as csv. Large DataFrames are formatted in row ranges on the global thread pool and
+     * written in order, in large blocks.
+     */
+    void write(const DataFrame& dataFrame, std::ostream& stream, std::string_view delimiter);
+
+    /**
+     * Writes the given rows of a DataFrame as csv, in the given order.
+     */
+    void write(const DataFrame& dataFrame, std::span<const size_t> rows, std::ostream& stream, std::string_view delimiter);
+
+}
+
+}
@@ -1,48 +1,64 @@
 #include "DataFrame.hpp"
+#include "BinaryFormat.hpp"
+#include "Bitmap.hpp"
+#include "CsvReader.hpp"
+#include "CsvWriter.hpp"
+#include "JsonReader.hpp"
+#include "JsonWriter.hpp"
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
+#include "QueryPlan.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <iostream>
-#include <unordered_map>
+#include <iterator>
+#include <numeric>
 
 namespace jdf {
 
-namespace {
-    json splitToColumnFormat(const auto& data)
-    {
-        json df;
-        std::unordered_map<std::string, size_t> columnMap;
-        for (size_t i = 0; i < data["columns"].size(); i++) {
-            columnMap[data["columns"][i]] = i;
-            df[data["columns"][i]] = json::array();
-        }
-        for (size_t row = 0; row < data["data"].size(); row++) {
-            for (size_t col = 0; col < data["columns"].size(); row++) {
-                df[columnMap[data["columns"][col]]].push_back(data["data"][row][col]);
-            }
-        }
-        return df;
+RowView::RowView(const DataFrame& dataFrame, size_t row)
+    : _dataFrame(&dataFrame)
+    , _row(row)
+{
+}
+
+json RowView::data() const
+{
+    json data;
+    for (size_t i = 0; i < _dataFrame->columnCount(); i++) {
+        data[_dataFrame->columnNames()[i]] = _dataFrame->column(i).get(_row);
     }
+    return data;
 }
 
-Series::Series(const json& data)
-    : _data(data)
+const DataFrame& RowView::dataFrame() const
 {
+    return *_dataFrame;
 }
 
-const json& Series::data() const
+size_t RowView::index() const
 {
-    return _data;
+    return _row;
 }
 
-DataFrameIterator::DataFrameIterator(const json& data, size_t index)
-    : _data(data)
+DataFrameIterator::DataFrameIterator(const DataFrame& dataFrame, size_t index)
+    : _dataFrame(&dataFrame)
+    , _index(index)
+{
+}
+
+DataFrameIterator::DataFrameIterator(const DataFrame& dataFrame, const size_t* rows, size_t index)
+    : _dataFrame(&dataFrame)
+    , _rows(rows)
     , _index(index)
 {
 }
 
 bool DataFrameIterator::operator!=(const DataFrameIterator& other) const
 {
-    return &_data != &other._data || _index != other._index;
+    return _dataFrame != other._dataFrame || _rows != other._rows || _index != other._index;
 }
 
 DataFrameIterator& DataFrameIterator::operator++()
@@ -51,111 +67,248 @@ DataFrameIterator& DataFrameIterator::operator++()
     return *this;
 }
 
-Series DataFrameIterator::operator*() const
+RowView DataFrameIterator::operator*() const
 {
-    return getSeries();
+    return RowView(*_dataFrame, _rows == nullptr ? _index : _rows[_index]);
 }
 
-Series DataFrameIterator::getSeries() const
+DataFrame::DataFrame(const json& data)
 {
-    json series;
-    for (const auto& column : _data.items()) {
-        series[column.key()] = _data[column.key()][_index];
-    }
-    return Series(series);
+    construct(data);
 }
 
-DataFrame::DataFrame(const json& data)
+DataFrame::DataFrame(json&& data)
 {
+    construct(data);
+}
+
+template <typename Json>
+void DataFrame::construct(Json& data)
+{
+    // A mutable json is moved from, rows and columns are released as soon as they have been converted.
+    constexpr bool isMovable = !std::is_const_v<Json>;
+    const auto forward = [](auto& value) -> decltype(auto) {
+        if constexpr (isMovable) {
+            return std::move(value);
+        } else {
+            return std::as_const(value);
+        }
+    };
+
+    _size = 0;
     const bool isOnlyHeader = data.is_array();
     if (isOnlyHeader) {
         for (const auto& column : data) {
-            _data[column] = json::array();
+            _columnIndices[column] = _columnNames.size();
+            _columnNames.push_back(column);
+            _columns.emplace_back();
         }
-        _size = 0;
         return;
     }
 
     const bool isSplitFormat = data.find("columns") != data.end() && data.find("data") != data.end();
-    _data = isSplitFormat ? splitToColumnFormat(data) : data;
+    if (isSplitFormat) {
+        const json& columns = data["columns"];
+        for (const auto& column : columns) {
+            _columnIndices[column] = _columnNames.size();
+            _columnNames.push_back(column);
+        }
+        _columns.resize(columns.size());
+        auto& rows = data["data"];
+        for (auto& row : rows) {
+            assert(row.size() == columns.size());
+            for (size_t col = 0; col < columns.size(); col++) {
+                _columns[col].push_back(forward(row[col]));
+            }
+            if constexpr (isMovable) {
+                row = nullptr;
+            }
+        }
+        _size = rows.size();
+        return;
+    }
 
-    _size = 0;
-    for (const auto& column : _data) {
+    for (auto& [name, values] : data.items()) {
+        assert(values.is_array());
+        _columnIndices[name] = _columnNames.size();
+        _columnNames.push_back(name);
+        auto& column = _columns.emplace_back();
+        column.reserve(values.size());
+        for (auto& value : values) {
+            column.push_back(forward(value));
+        }
+        if constexpr (isMovable) {
+            values = nullptr;
+        }
         assert(_size == 0 || _size == column.size());
         _size = column.size();
     }
 }
 
+DataFrame::DataFrame(std::vector<std::string> columnNames, std::vector<Column> columns)
+    : _columnNames(std::move(columnNames))
+    , _columns(std::move(columns))
+    , _size(0)
+{
+    assert(_columnNames.size() == _columns.size());
+    for (size_t i = 0; i < _columnNames.size(); i++) {
+        _columnIndices[_columnNames[i]] = i;
+        assert(i == 0 || _size == _columns[i].size());
+        _size = _columns[i].size();
+    }
+}
+
 void DataFrame::addRow(const json& row)
 {
-    assert(row.size() == _data.size());
+    assert(row.size() == _columns.size());
     for (const auto& column : row.items()) {
-        assert(_data.find(column.key()) != _data.end());
-        _data[column.key()].push_back(column.value());
+        const auto index = columnIndex(column.key());
+        assert(index.has_value());
+        _columns[*index].push_back(column.value());
     }
     _size++;
+    updateIndices();
 }
 
-DataFrame DataFrame::query(std::unique_ptr<BooleanExpression> expression) const
+void DataFrame::appendRows(const json& rows)
 {
-    auto const getOr = [&](const json& col, size_t index) -> const json& {
-        if (col.is_string() && _data.find(col) != _data.end()) {
-            return _data[col][index];
+    if (rows.is_object()) {
+        size_t rowCount = 0;
+        for (const auto& column : rows.items()) {
+            const auto index = columnIndex(column.key());
+            assert(index.has_value() && column.value().is_array());
+            assert(rowCount == 0 || rowCount == column.value().size());
+            rowCount = column.value().size();
+            _columns[*index].reserve(_size + rowCount);
+            for (const auto& value : column.value()) {
+                _columns[*index].push_back(value);
+            }
         }
-        return col;
-    };
+        assert(rows.size() == _columns.size() || rowCount == 0);
+        _size += rowCount;
+        updateIndices();
+        return;
+    }
 
-    json df;
-    for (size_t row = 0; row < size(); row++) {
-        const auto rowEvaluator = [&](const json& col1, Operator op, const json& col2) {
-            switch (op) {
-            case Operator::Equal:
-                return getOr(col1, row) == getOr(col2, row);
-            case Operator::NotEqual:
-                return getOr(col1, row) != getOr(col2, row);
-            case Operator::Less:
-                return getOr(col1, row) < getOr(col2, row);
-            case Operator::LessOrEqual:
-                return getOr(col1, row) <= getOr(col2, row);
-            case Operator::Greater:
-                return getOr(col1, row) > getOr(col2, row);
-            case Operator::GreaterOrEqual:
-                return getOr(col1, row) >= getOr(col2, row);
+    assert(rows.is_array());
+    reserve(_size + rows.size());
+    // Rows usually have the same keys, so the columns of the previous row are tried before looking up a key.
+    std::vector<size_t> columnOrder;
+    for (const auto& row : rows) {
+        assert(row.size() == _columns.size());
+        if (row.is_array()) {
+            for (size_t column = 0; column < _columns.size(); column++) {
+                _columns[column].push_back(row[column]);
             }
-            return true;
-        };
-        if (expression->eval(rowEvaluator)) {
-            for (const auto& col : _data.items()) {
-                df[col.key()].push_back(col.value()[row]);
+            continue;
+        }
+
+        columnOrder.resize(_columns.size(), 0);
+        size_t position = 0;
+        for (const auto& column : row.items()) {
+            if (_columnNames[columnOrder[position]] != column.key()) {
+                const auto index = columnIndex(column.key());
+                assert(index.has_value());
+                columnOrder[position] = *index;
             }
+            _columns[columnOrder[position++]].push_back(column.value());
         }
     }
+    _size += rows.size();
+    updateIndices();
+}
 
-    return DataFrame(df);
+void DataFrame::reserve(size_t rows)
+{
+    for (auto& column : _columns) {
+        column.reserve(rows);
+    }
 }
 
-DataFrame DataFrame::queryEq(std::string_view column, const json& value) const
+void DataFrame::updateIndices()
 {
-    json df;
-    if (_data.find(column) == _data.end()) {
-        return DataFrame(df);
+    for (auto& [column, index] : _hashIndices) {
+        index.update(_columns[column]);
+    }
+    for (auto& [column, index] : _sortedIndices) {
+        index.update(_columns[column]);
     }
+}
+
+void DataFrame::createIndex(std::string_view column)
+{
+    const auto index = columnIndex(column);
+    assert(index.has_value());
+    _hashIndices.insert_or_assign(*index, HashIndex(_columns[*index]));
+}
 
-    for (const auto& col : _data.items()) {
-        df[col.key()] = json::array();
+const HashIndex* DataFrame::hashIndex(size_t column) const
+{
+    const auto it = _hashIndices.find(column);
+    return it == _hashIndices.end() ? nullptr : &it->second;
+}
+
+void DataFrame::createSortedIndex(std::string_view column)
+{
+    const auto index = columnIndex(column);
+    assert(index.has_value());
+    _sortedIndices.insert_or_assign(*index, SortedIndex(_columns[*index]));
+}
+
+const SortedIndex* DataFrame::sortedIndex(size_t column) const
+{
+    const auto it = _sortedIndices.find(column);
+    return it == _sortedIndices.end() ? nullptr : &it->second;
+}
+
+void DataFrame::encodeDictionary(std::string_view column)
+{
+    const auto index = columnIndex(column);
+    assert(index.has_value());
+    _columns[*index].encodeDictionary();
+}
+
+DataFrame DataFrame::query(std::unique_ptr<BooleanExpression> expression) const
+{
+    ProfileScope profile("query");
+    profile.stage("filter");
+    const auto rows = QueryPlan::compile(*expression, *this).selectedRows();
+    profile.stage("gather");
+    profile.rows(size(), rows.size());
+    return take(rows);
+}
+
+DataFrame DataFrame::queryEq(std::string_view column, const json& value) const
+{
+    const auto index = columnIndex(column);
+    if (!index.has_value()) {
+        return DataFrame(json());
     }
 
-    const json& columnOfInterest = _data[column];
+    ProfileScope profile("queryEq");
+    profile.stage("filter");
+    const auto rows = QueryPlan::compile(*this, *index, Operator::Equal, value).selectedRows();
+    profile.stage("gather");
+    profile.rows(size(), rows.size());
+    return take(rows);
+}
 
-    for (size_t row = 0; row < size(); row++) {
-        if (columnOfInterest[row] == value) {
-            for (const auto& col : _data.items()) {
-                df[col.key()].push_back(col.value()[row]);
-            }
+DataFrame DataFrame::take(std::span<const size_t> rows) const
+{
+    // Columns are gathered in parallel once the copy outweighs the cost of waking up the pool.
+    constexpr size_t minParallelRows = 1 << 16;
+    std::vector<Column> columns(_columns.size());
+    const auto takeColumn = [&](size_t column) {
+        columns[column] = _columns[column].take(rows);
+    };
+    if (rows.size() >= minParallelRows) {
+        ThreadPool::global().run(_columns.size(), takeColumn);
+    } else {
+        for (size_t column = 0; column < _columns.size(); column++) {
+            takeColumn(column);
         }
     }
-
-    return DataFrame(df);
+    return DataFrame(_columnNames, std::move(columns));
 }
 
 size_t DataFrame::size() const
@@ -163,57 +316,247 @@ size_t DataFrame::size() const
     return _size;
 }
 
-Series DataFrame::first() const
+RowView DataFrame::first() const
 {
     return at(0);
 }
 
-Series DataFrame::at(size_t index) const
+RowView DataFrame::at(size_t index) const
 {
     assert(index < size());
-    return *DataFrameIterator(_data, index);
+    return RowView(*this, index);
 }
 
 void DataFrame::toCsv(std::ostream& stream, std::string_view delimiter) const
 {
-    const size_t columnCount = _data.size();
-    size_t currentColumn = 0;
-    for (const auto& column : _data.items()) {
-        stream << column.key();
-        if (currentColumn < columnCount - 1) {
-            stream << delimiter;
+    csv::write(*this, stream, delimiter);
+}
+
+void DataFrame::toCsv(std::string_view path, std::string_view delimiter) const
+{
+    std::ofstream file(std::string { path });
+    assert(file.is_open());
+    toCsv(file, delimiter);
+}
+
+void DataFrame::toNdjson(std::ostream& stream) const
+{
+    jsonformat::writeLines(*this, stream);
+}
+
+void DataFrame::toNdjson(std::string_view path) const
+{
+    std::ofstream file(std::string { path });
+    assert(file.is_open());
+    toNdjson(file);
+}
+
+void DataFrame::toBinary(std::string_view path) const
+{
+    binary::write(*this, path);
+}
+
+DataFrameIterator DataFrame::begin() const
+{
+    return DataFrameIterator(*this, 0);
+}
+
+DataFrameIterator DataFrame::end() const
+{
+    return DataFrameIterator(*this, _size);
+}
+
+GroupBy DataFrame::groupBy(std::vector<std::string> keys) const
+{
+    return GroupBy(*this, std::move(keys));
+}
+
+DataFrame DataFrame::join(const DataFrame& other, const std::vector<std::string>& on, JoinType how) const
+{
+    return hashJoin(*this, other, on, how);
+}
+
+DataFrame DataFrame::sortBy(const std::vector<std::string>& columns, bool ascending) const
+{
+    return take(argsort(*this, columns, ascending));
+}
+
+DataFrame DataFrame::topK(std::string_view column, size_t k) const
+{
+    return take(topKRows(*this, column, k));
+}
+
+void DataFrame::parallelForEach(const std::function<void(const RowView&)>& function) const
+{
+    constexpr size_t morselSize = 4096;
+    ThreadPool::global().run((_size + morselSize - 1) / morselSize, [&](size_t morsel) {
+        const size_t end = std::min(_size, (morsel + 1) * morselSize);
+        for (size_t row = morsel * morselSize; row < end; row++) {
+            function(RowView(*this, row));
         }
-        currentColumn++;
+    });
+}
+
+DataFrameView DataFrame::view() const
+{
+    std::vector<size_t> rows(_size);
+    std::iota(rows.begin(), rows.end(), size_t { 0 });
+    return DataFrameView(*this, std::move(rows));
+}
+
+json DataFrame::memoryUsage() const
+{
+    json columns = json::object();
+    size_t total = 0;
+    for (size_t column = 0; column < _columns.size(); column++) {
+        const size_t size = _columns[column].memoryUsage();
+        columns[_columnNames[column]] = size;
+        total += size;
+    }
+    size_t indices = 0;
+    for (const auto& [column, index] : _hashIndices) {
+        indices += index.memoryUsage();
+    }
+    for (const auto& [column, index] : _sortedIndices) {
+        indices += index.memoryUsage();
+    }
+    return { { "columns", std::move(columns) }, { "indices", indices }, { "total", total + indices } };
+}
+
+size_t DataFrame::columnCount() const
+{
+    return _columns.size();
+}
+
+const std::vector<std::string>& DataFrame::columnNames() const
+{
+    return _columnNames;
+}
+
+std::optional<size_t> DataFrame::columnIndex(std::string_view name) const
+{
+    const auto it = _columnIndices.find(name);
+    if (it == _columnIndices.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+const Column& DataFrame::column(size_t index) const
+{
+    assert(index < _columns.size());
+    return _columns[index];
+}
+
+const Column& DataFrame::column(std::string_view name) const
+{
+    const auto index = columnIndex(name);
+    assert(index.has_value());
+    return _columns[*index];
+}
+
+DataFrameView::DataFrameView(const DataFrame& dataFrame, std::vector<size_t> rows)
+    : _dataFrame(&dataFrame)
+    , _rows(std::move(rows))
+{
+}
+
+DataFrameView DataFrameView::query(std::unique_ptr<BooleanExpression> expression) const
+{
+    return select(QueryPlan::compile(*expression, *_dataFrame));
+}
+
+DataFrameView DataFrameView::queryEq(std::string_view column, const json& value) const
+{
+    const auto index = _dataFrame->columnIndex(column);
+    if (!index.has_value()) {
+        return DataFrameView(*_dataFrame, {});
     }
-    stream << "\n";
-    for (size_t row = 0; row < size(); row++) {
-        currentColumn = 0;
-        for (const auto& column : _data.items()) {
-            stream << column.value()[row];
-            if (currentColumn < columnCount - 1) {
-                stream << delimiter;
+    return select(QueryPlan::compile(*_dataFrame, *index, Operator::Equal, value));
+}
+
+DataFrameView DataFrameView::select(const QueryPlan& plan) const
+{
+    const bool isAllRows = _rows.size() == _dataFrame->size();
+    std::vector<size_t> rows;
+    if (const auto indexedRows = plan.indexedRows()) {
+        if (isAllRows) {
+            rows.assign(indexedRows->begin(), indexedRows->end());
+        } else {
+            std::set_intersection(_rows.begin(), _rows.end(), indexedRows->begin(), indexedRows->end(), std::back_inserter(rows));
+        }
+    } else if (_rows.size() < _dataFrame->size() / 32) {
+        // Evaluating few rows one by one is cheaper than evaluating all rows with the kernels.
+        for (const size_t row : _rows) {
+            if (plan.matches(row)) {
+                rows.push_back(row);
+            }
+        }
+    } else if (isAllRows) {
+        rows = plan.selectedRows();
+    } else {
+        Bitmap selection(_dataFrame->size());
+        plan.evaluate(selection);
+        for (const size_t row : _rows) {
+            if (selection.test(row)) {
+                rows.push_back(row);
             }
-            currentColumn++;
         }
-        stream << "\n";
     }
+    return DataFrameView(*_dataFrame, std::move(rows));
 }
 
-void DataFrame::toCsv(std::string_view path, std::string_view delimiter) const
+size_t DataFrameView::size() const
+{
+    return _rows.size();
+}
+
+RowView DataFrameView::at(size_t index) const
+{
+    assert(index < size());
+    return RowView(*_dataFrame, _rows[index]);
+}
+
+RowView DataFrameView::first() const
+{
+    return at(0);
+}
+
+void DataFrameView::toCsv(std::ostream& stream, std::string_view delimiter) const
+{
+    csv::write(*_dataFrame, _rows, stream, delimiter);
+}
+
+void DataFrameView::toCsv(std::string_view path, std::string_view delimiter) const
 {
     std::ofstream file(std::string { path });
     assert(file.is_open());
     toCsv(file, delimiter);
 }
 
-DataFrameIterator DataFrame::begin() const
+DataFrame DataFrameView::materialize() const
 {
-    return DataFrameIterator(_data, 0);
+    return _dataFrame->take(_rows);
 }
 
-DataFrameIterator DataFrame::end() const
+DataFrameIterator DataFrameView::begin() const
 {
-    return DataFrameIterator(_data, _size);
+    return DataFrameIterator(*_dataFrame, _rows.data(), 0);
+}
+
+DataFrameIterator DataFrameView::end() const
+{
+    return DataFrameIterator(*_dataFrame, _rows.data(), _rows.size());
+}
+
+const DataFrame& DataFrameView::dataFrame() const
+{
+    return *_dataFrame;
+}
+
+std::span<const size_t> DataFrameView::rows() const
+{
+    return _rows;
 }
 
 DataFrame fromJson(const json& data)
@@ -223,58 +566,86 @@ DataFrame fromJson(const json& data)
 
 DataFrame fromJson(std::string_view path)
 {
-    std::ifstream file(std::string { path });
-    assert(file.is_open());
-    return DataFrame(json::parse(file));
+    const MappedFile file(path, MappedFile::Access::Sequential);
+    return jsonformat::parse(file.data());
+}
+
+DataFrame fromNdjson(std::string_view path)
+{
+    const MappedFile file(path, MappedFile::Access::Sequential);
+    return jsonformat::parseLines(file.data());
+}
+
+DataFrame fromNdjson(std::istream& stream)
+{
+    const std::string text(std::istreambuf_iterator<char>(stream), {});
+    return jsonformat::parseLines(text);
 }
 
 DataFrame fromCsv(std::string_view path, std::string_view delimiter)
 {
-    std::ifstream file(std::string { path });
-    assert(file.is_open());
-    return fromCsv(file, delimiter);
+    const MappedFile file(path, MappedFile::Access::Sequential);
+    return csv::parse(file.data(), delimiter);
 }
 
 DataFrame fromCsv(std::istream& stream, std::string_view delimiter)
 {
-    json df;
-    std::string line;
-    size_t lineCount = 0;
-    std::unordered_map<size_t, std::string> columnMap;
-
-    while (std::getline(stream, line)) {
-        const auto stringRow = splitString(line, delimiter);
-        if (lineCount == 0) {
-            for (size_t i = 0; i < stringRow.size(); i++) {
-                df[stringRow[i]] = json::array();
-                columnMap[i] = stringRow[i];
-            }
-        } else {
-            for (size_t i = 0; i < stringRow.size(); i++) {
-                const json value = json::parse(stringRow[i], nullptr, false);
-                df[columnMap[i]].push_back(value.is_discarded() ? json(columnMap[i]) : value);
-            }
-        }
-        lineCount++;
+    const std::string text(std::istreambuf_iterator<char>(stream), {});
+    return csv::parse(text, delimiter);
+}
+
+DataFrame mapBinary(std::string_view path)
+{
+    return binary::map(path);
+}
+
+DataFrame concat(std::vector<DataFrame> frames)
+{
+    if (frames.empty()) {
+        return DataFrame(json::array());
     }
 
-    return DataFrame(df);
+    size_t rowCount = 0;
+    for (const auto& frame : frames) {
+        assert(frame.columnCount() == frames[0].columnCount());
+        rowCount += frame.size();
+    }
+
+    // The buffers of the first frame are moved into the result, the other frames are appended column by
+    // column.
+    DataFrame result = std::move(frames[0]);
+    result.reserve(rowCount);
+    for (size_t frame = 1; frame < frames.size(); frame++) {
+        for (size_t column = 0; column < result.columnCount(); column++) {
+            const auto index = frames[frame].columnIndex(result._columnNames[column]);
+            assert(index.has_value());
+            result._columns[column].append(frames[frame].column(*index));
+        }
+        result._size += frames[frame].size();
+    }
+    result.updateIndices();
+    return result;
 }
 
-std::vector<std::string> splitString(std::string str, std::string_view delimiter)
+std::vector<std::string_view> splitStringView(std::string_view str, std::string_view delimiter)
 {
-    std::vector<std::string> row;
+    std::vector<std::string_view> row;
+    size_t begin = 0;
     size_t pos = 0;
-    std::string token;
-    while ((pos = str.find(delimiter.data())) != std::string::npos) {
-        token = str.substr(0, pos);
-        row.push_back(token);
-        str.erase(0, pos + delimiter.length());
+    while ((pos = str.find(delimiter, begin)) != std::string_view::npos) {
+        row.push_back(str.substr(begin, pos - begin));
+        begin = pos + delimiter.length();
     }
-    row.push_back(str);
+    row.push_back(str.substr(begin));
     return row;
 }
 
+std::vector<std::string> splitString(std::string str, std::string_view delimiter)
+{
+    const auto tokens = splitStringView(str, delimiter);
+    return std::vector<std::string>(tokens.begin(), tokens.end());
+}
+
 DataFrameWriter::DataFrameWriter(const json& data, std::string_view path)
     : _dataFrame(data)
     , _path(path)
@@ -1,54 +1,104 @@
 #pragma once
 #include "BooleanExpression.hpp"
+#include "Column.hpp"
+#include "GroupBy.hpp"
+#include "Join.hpp"
+#include "Sort.hpp"
+#include "HashIndex.hpp"
+#include "SortedIndex.hpp"
+#include <functional>
 #include <istream>
 #include <memory>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <span>
+#include <unordered_map>
 
 namespace jdf {
 
 using json = nlohmann::json;
 
+class DataFrame;
 template <typename T>
-struct SeriesConverter {
-    static T convert(const json& data, std::string_view column)
-    {
-        return data[column].get<T>();
-    }
-};
+struct SeriesConverter;
 
-class Series {
+/**
+ * A view of a single row of a DataFrame. Values are read directly from the columns of the DataFrame,
+ * which has to outlive the view.
+ */
+class RowView {
 public:
-    explicit Series(const json& data);
+    RowView(const DataFrame& dataFrame, size_t row);
+
+    /**
+     * Returns SeriesConverter<T>::convert(row, columns). Specializations written against the former json
+     * based Series, i.e. with convert(const json& row, std::string_view columns), are called with data().
+     */
     template <typename T>
     T get(const std::string_view columns) const
     {
-        return SeriesConverter<T>::convert(_data, columns);
+        if constexpr (requires { SeriesConverter<T>::convert(*this, columns); }) {
+            return SeriesConverter<T>::convert(*this, columns);
+        } else {
+            return SeriesConverter<T>::convert(data(), columns);
+        }
     }
-    const json& data() const;
+
+    /**
+     * Returns the value of a single column converted to T.
+     */
+    template <typename T>
+    T value(std::string_view column) const;
+
+    /**
+     * Returns the row as a json object, copying all of its values.
+     */
+    json data() const;
+    const DataFrame& dataFrame() const;
+    size_t index() const;
 
 private:
-    json _data;
+    const DataFrame* _dataFrame;
+    size_t _row;
+};
+
+using Series = RowView;
+
+template <typename T>
+struct SeriesConverter {
+    static T convert(const RowView& row, std::string_view column)
+    {
+        return row.value<T>(column);
+    }
 };
 
 struct DataFrameIterator {
     using iterator_category = std::forward_iterator_tag;
     using difference_type = std::ptrdiff_t;
-    using value_type = Series;
+    using value_type = RowView;
     using pointer = value_type*;
     using reference = value_type&;
 
-    DataFrameIterator(const json& data, size_t index);
+    DataFrameIterator(const DataFrame& dataFrame, size_t index);
+
+    /**
+     * Constructs an iterator over the given rows of a DataFrame.
+     */
+    DataFrameIterator(const DataFrame& dataFrame, const size_t* rows, size_t index);
     bool operator!=(const DataFrameIterator& other) const;
 
     DataFrameIterator& operator++();
-    Series operator*() const;
+    RowView operator*() const;
 
 private:
-    Series getSeries() const;
-    json const& _data;
+    const DataFrame* _dataFrame;
+    const size_t* _rows = nullptr;
     size_t _index;
 };
 
+class DataFrameView;
+class QueryPlan;
+
 class DataFrame {
 public:
     /**
@@ -71,33 +121,243 @@ public:
      * free functions fromJson and fromCsv.
      */
     explicit DataFrame(const json& data);
+
+    /**
+     * Constructs a new DataFrame from a json object in the same formats, moving its values and releasing
+     * its rows or columns as soon as they have been converted.
+     */
+    explicit DataFrame(json&& data);
+
+    /**
+     * Constructs a new DataFrame from already built columns, which all must have the same size.
+     */
+    DataFrame(std::vector<std::string> columnNames, std::vector<Column> columns);
     void addRow(const json& row);
 
+    /**
+     * Appends a batch of rows, either as an array of rows, each being an object like in addRow or an
+     * array of values in column order, or as an object with an equally long array of values per column.
+     */
+    void appendRows(const json& rows);
+
+    /**
+     * Reserves memory for the given total number of rows in every column.
+     */
+    void reserve(size_t rows);
+
+    /**
+     * Builds a hash index on the given column, which is used by queryEq and by equality comparisons
+     * between the column and a literal in query. The index is updated by addRow.
+     */
+    void createIndex(std::string_view column);
+    const HashIndex* hashIndex(size_t column) const;
+
+    /**
+     * Builds a sorted index on the given column, which is used by range comparisons between the column
+     * and a literal in query. The index is updated by addRow.
+     */
+    void createSortedIndex(std::string_view column);
+    const SortedIndex* sortedIndex(size_t column) const;
+
+    /**
+     * Dictionary encodes a String column: every value is stored as a code into the distinct values of the
+     * column. Equality comparisons with a literal and groupBy compare the codes instead of the strings.
+     */
+    void encodeDictionary(std::string_view column);
+
+    /**
+     * Returns the rows for which expression holds. Large DataFrames are split into morsels of rows that
+     * are evaluated in parallel on the global thread pool, see ThreadPool::setGlobalThreadCount.
+     */
     DataFrame query(std::unique_ptr<BooleanExpression> expression) const;
     DataFrame queryEq(std::string_view column, const json& value) const;
     size_t size() const;
-    Series at(size_t index) const;
-    Series first() const;
+    RowView at(size_t index) const;
+    RowView first() const;
     void toCsv(std::ostream& stream, std::string_view delimiter = ",") const;
     void toCsv(std::string_view path, std::string_view delimiter = ",") const;
+    /**
+     * Writes the DataFrame as json lines, one object per row.
+     */
+    void toNdjson(std::ostream& stream) const;
+    void toNdjson(std::string_view path) const;
+    /**
+     * Writes the DataFrame in the binary columnar format, which can be loaded again with mapBinary.
+     */
+    void toBinary(std::string_view path) const;
 
     DataFrameIterator begin() const;
     DataFrameIterator end() const;
 
+    /**
+     * Groups the rows by the values of the given key columns, e.g.
+     *   df.groupBy({ "city" }).agg({ { "price", Aggregation::Sum }, { "price", Aggregation::Mean } })
+     */
+    GroupBy groupBy(std::vector<std::string> keys) const;
+
+    /**
+     * Joins this DataFrame with other on the columns named on, see hashJoin.
+     */
+    DataFrame join(const DataFrame& other, const std::vector<std::string>& on, JoinType how = JoinType::Inner) const;
+
+    /**
+     * Returns the DataFrame sorted by the given columns, see argsort.
+     */
+    DataFrame sortBy(const std::vector<std::string>& columns, bool ascending = true) const;
+
+    /**
+     * Returns the k rows with the largest values of column, largest first.
+     */
+    DataFrame topK(std::string_view column, size_t k) const;
+
+    /**
+     * Copies the comma separated columns into an Eigen::Matrix<Scalar, Eigen::Dynamic, Columns> in one pass
+     * per column, e.g. toMatrix<float, 3>("x,y,z") for a point cloud. Columns defaults to Eigen::Dynamic.
+     * @note Defined in EigenConversions.hpp.
+     */
+    template <typename Scalar, int Columns = -1>
+    auto toMatrix(std::string_view columns) const;
+
+    /**
+     * Like toMatrix(columns), with the number of matrix columns taken from the list of column names, e.g.
+     * toMatrix<float>({ "x", "y", "z" }) returns an Eigen::Matrix<float, Eigen::Dynamic, 3>.
+     * @note Defined in EigenConversions.hpp.
+     */
+    template <typename Scalar, size_t Count>
+    auto toMatrix(const char* const (&columns)[Count]) const;
+
+    /**
+     * Returns an Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>> viewing the values of an Int
+     * (int64_t), Double (double) or Bool (uint8_t) column without copying them. Null rows hold zero, see
+     * Column::nulls(). The map is invalidated when the column is modified.
+     * @note Defined in EigenConversions.hpp.
+     */
+    template <typename T>
+    auto columnMap(std::string_view column) const;
+
+    /**
+     * Calls function for every row, in parallel on the global thread pool and in no particular order.
+     */
+    void parallelForEach(const std::function<void(const RowView&)>& function) const;
+
+    /**
+     * Returns a view of all rows, which can be filtered by chained queries without copying any values.
+     */
+    DataFrameView view() const;
+
+    /**
+     * Returns a new DataFrame containing the given rows, in the given order.
+     */
+    DataFrame take(std::span<const size_t> rows) const;
+
+    /**
+     * Returns the heap memory of the DataFrame in bytes, including allocator overhead, as
+     *   { "columns": { "col1": bytes, ... }, "indices": bytes, "total": bytes }
+     * Columns mapped by mapBinary take no heap memory until they are modified, the dictionary of an
+     * encoded column is counted for every column sharing it.
+     */
+    json memoryUsage() const;
+
+    size_t columnCount() const;
+    const std::vector<std::string>& columnNames() const;
+    std::optional<size_t> columnIndex(std::string_view name) const;
+    const Column& column(size_t index) const;
+    const Column& column(std::string_view name) const;
+
 private:
-    json _data;
+    friend DataFrame concat(std::vector<DataFrame> frames);
+
+    template <typename Json>
+    void construct(Json& data);
+    void updateIndices();
+
+    std::vector<std::string> _columnNames;
+    std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> _columnIndices;
+    std::vector<Column> _columns;
+    std::unordered_map<size_t, HashIndex> _hashIndices;
+    std::unordered_map<size_t, SortedIndex> _sortedIndices;
     size_t _size;
 };
 
+/**
+ * A DataFrame filtered by a selection of rows, in ascending order. Queries on a view only narrow the
+ * selection, values are copied by materialize() and written by toCsv without copying.
+ * The DataFrame has to outlive the view and must not be modified while the view is in use.
+ */
+class DataFrameView {
+public:
+    DataFrameView(const DataFrame& dataFrame, std::vector<size_t> rows);
+
+    DataFrameView query(std::unique_ptr<BooleanExpression> expression) const;
+    DataFrameView queryEq(std::string_view column, const json& value) const;
+    size_t size() const;
+    RowView at(size_t index) const;
+    RowView first() const;
+    void toCsv(std::ostream& stream, std::string_view delimiter = ",") const;
+    void toCsv(std::string_view path, std::string_view delimiter = ",") const;
+
+    /**
+     * Copies the selected rows into a new DataFrame.
+     */
+    DataFrame materialize() const;
+
+    DataFrameIterator begin() const;
+    DataFrameIterator end() const;
+
+    const DataFrame& dataFrame() const;
+    std::span<const size_t> rows() const;
+
+private:
+    DataFrameView select(const QueryPlan& plan) const;
+
+    const DataFrame* _dataFrame;
+    std::vector<size_t> _rows;
+};
+
+/**
+ * Reads a json file in one of the formats of the DataFrame constructor with a streaming parser, which
+ * builds the columns without an intermediate json document.
+ * @note The functions reading a file throw std::system_error if the file cannot be opened.
+ */
 DataFrame fromJson(std::string_view path);
 DataFrame fromJson(const json& data);
+/**
+ * Reads json lines, one object per line, directly into columns, see NdjsonBatchReader for reading large
+ * files in batches.
+ */
+DataFrame fromNdjson(std::string_view path);
+DataFrame fromNdjson(std::istream& stream);
 DataFrame fromCsv(std::string_view path, std::string_view delimiter = ",");
 DataFrame fromCsv(std::istream& stream, std::string_view delimiter = ",");
+/**
+ * Concatenates the rows of DataFrames with the same column names. Columns are matched by name and widened
+ * as needed. The column buffers of the first DataFrame are moved into the result and the other DataFrames
+ * are appended column by column.
+ */
+DataFrame concat(std::vector<DataFrame> frames);
+/**
+ * Loads a file written by toBinary without copying: the columns are read-only views of the memory mapped
+ * file, which is shared between processes mapping the same file. A column is copied on its first
+ * modification.
+ */
+DataFrame mapBinary(std::string_view path);
+
+template <typename T>
+T RowView::value(std::string_view column) const
+{
+    return _dataFrame->column(column).value<T>(_row);
+}
 
 std::vector<std::string> splitString(std::string str, std::string_view delimiter);
 
+/**
+ * Splits str like splitString, returning views into str instead of copying every token.
+ */
+std::vector<std::string_view> splitStringView(std::string_view str, std::string_view delimiter);
+
 /**
  * A wrapper around a DataFrame that writes the DataFrame to a file, in csv format, when it goes out of scope.
+ * See AsyncDataFrameWriter for writing rows incrementally while they are added.
  */
 class DataFrameWriter {
 public:
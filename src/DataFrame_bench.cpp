@@ -0,0 +1,204 @@
+#include "DataFrame.hpp"
+#include "EigenConversions.hpp"
+#include <Eigen/Core>
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+
+using namespace jdf;
+
+// Run with --benchmark_format=json or --benchmark_out=results.json --benchmark_out_format=json to track
+// the results across versions.
+
+namespace {
+
+constexpr size_t categoryCount = 16;
+
+/**
+ * Generates a DataFrame of mixed types: an Int id, Double x, y and z, a Bool flag, a low cardinality
+ * category and a unique name. The values are deterministic.
+ */
+DataFrame generate(size_t rows)
+{
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<int64_t> ids(rows);
+    std::vector<double> x(rows), y(rows), z(rows);
+    std::vector<uint8_t> flags(rows);
+    std::vector<std::string> categories(rows), names(rows);
+    for (size_t row = 0; row < rows; row++) {
+        ids[row] = static_cast<int64_t>(row);
+        x[row] = uniform(random);
+        y[row] = uniform(random);
+        z[row] = uniform(random);
+        flags[row] = random() % 2;
+        categories[row] = "category" + std::to_string(random() % categoryCount);
+        names[row] = "name" + std::to_string(row);
+    }
+
+    std::vector<Column> columns;
+    columns.emplace_back(Column::Storage(ColumnBuffer<int64_t>(std::move(ids))));
+    columns.emplace_back(Column::Storage(ColumnBuffer<double>(std::move(x))));
+    columns.emplace_back(Column::Storage(ColumnBuffer<double>(std::move(y))));
+    columns.emplace_back(Column::Storage(ColumnBuffer<double>(std::move(z))));
+    columns.emplace_back(Column::Storage(ColumnBuffer<uint8_t>(std::move(flags))));
+    columns.emplace_back(Column::Storage(StringBuffer(std::move(categories))));
+    columns.emplace_back(Column::Storage(StringBuffer(std::move(names))));
+    return DataFrame({ "id", "x", "y", "z", "flag", "category", "name" }, std::move(columns));
+}
+
+/**
+ * Returns the generated DataFrame of the given size, which is generated once per process.
+ */
+const DataFrame& syntheticFrame(size_t rows)
+{
+    static std::map<size_t, std::unique_ptr<DataFrame>> frames;
+    auto& frame = frames[rows];
+    if (frame == nullptr) {
+        frame = std::make_unique<DataFrame>(generate(rows));
+    }
+    return *frame;
+}
+
+const std::string& syntheticCsv(size_t rows)
+{
+    static std::map<size_t, std::string> documents;
+    auto& document = documents[rows];
+    if (document.empty()) {
+        std::stringstream stream;
+        syntheticFrame(rows).toCsv(stream);
+        document = stream.str();
+    }
+    return document;
+}
+
+/**
+ * A stream buffer that counts the written bytes and discards them.
+ */
+class CountingBuffer : public std::streambuf {
+public:
+    size_t size = 0;
+
+protected:
+    std::streamsize xsputn(const char*, std::streamsize count) override
+    {
+        size += count;
+        return count;
+    }
+    int overflow(int character) override
+    {
+        size++;
+        return character;
+    }
+};
+
+/**
+ * Reports rows/s and, for operations with a meaningful number of bytes read or written, bytes/s.
+ */
+void setThroughput(benchmark::State& state, size_t rowsPerIteration, size_t bytesPerIteration = 0)
+{
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * rowsPerIteration));
+    if (bytesPerIteration != 0) {
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytesPerIteration));
+    }
+}
+
+void fromCsvBenchmark(benchmark::State& state)
+{
+    const size_t rows = state.range(0);
+    const std::string& document = syntheticCsv(rows);
+    for (auto _ : state) {
+        std::istringstream stream(document);
+        benchmark::DoNotOptimize(fromCsv(stream));
+    }
+    setThroughput(state, rows, document.size());
+}
+
+void toCsvBenchmark(benchmark::State& state)
+{
+    const DataFrame& df = syntheticFrame(state.range(0));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        CountingBuffer buffer;
+        std::ostream stream(&buffer);
+        df.toCsv(stream);
+        bytes = buffer.size;
+    }
+    setThroughput(state, df.size(), bytes);
+}
+
+void queryBenchmark(benchmark::State& state)
+{
+    const DataFrame& df = syntheticFrame(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(df.query("x"_c < 0.5 && "category"_c == "category3"));
+    }
+    setThroughput(state, df.size(), df.size() * 2 * sizeof(double));
+}
+
+void queryEqBenchmark(benchmark::State& state)
+{
+    const DataFrame& df = syntheticFrame(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(df.queryEq("category", "category3"));
+    }
+    setThroughput(state, df.size());
+}
+
+void addRowBenchmark(benchmark::State& state)
+{
+    const size_t rows = state.range(0);
+    for (auto _ : state) {
+        DataFrame df({ "id", "x", "flag", "category" });
+        for (size_t row = 0; row < rows; row++) {
+            df.addRow({ { "id", row }, { "x", row * 0.5 }, { "flag", row % 2 == 0 }, { "category", "category" + std::to_string(row % categoryCount) } });
+        }
+        benchmark::DoNotOptimize(df);
+    }
+    setThroughput(state, rows);
+}
+
+void iterationBenchmark(benchmark::State& state)
+{
+    const DataFrame& df = syntheticFrame(state.range(0));
+    for (auto _ : state) {
+        double sum = 0.0;
+        for (const auto& row : df) {
+            sum += row.value<double>("x");
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    setThroughput(state, df.size(), df.size() * sizeof(double));
+}
+
+void seriesConverterBenchmark(benchmark::State& state)
+{
+    const DataFrame& df = syntheticFrame(state.range(0));
+    for (auto _ : state) {
+        Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+        for (const auto& row : df) {
+            sum += row.get<Eigen::Vector3f>("x,y,z");
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    setThroughput(state, df.size(), df.size() * 3 * sizeof(double));
+}
+
+void rowCounts(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Arg(10'000)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+}
+
+BENCHMARK(fromCsvBenchmark)->Apply(rowCounts);
+BENCHMARK(toCsvBenchmark)->Apply(rowCounts);
+BENCHMARK(queryBenchmark)->Apply(rowCounts);
+BENCHMARK(queryEqBenchmark)->Apply(rowCounts);
+BENCHMARK(addRowBenchmark)->Apply(rowCounts);
+BENCHMARK(iterationBenchmark)->Apply(rowCounts);
+BENCHMARK(seriesConverterBenchmark)->Apply(rowCounts);
+
+BENCHMARK_MAIN();
@@ -1,9 +1,17 @@
+#include "AsyncDataFrameWriter.hpp"
+#include "CsvBatchReader.hpp"
 #include "DataFrame.hpp"
 #include "EigenConversions.hpp"
+#include "NdjsonBatchReader.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include "TypedDataFrame.hpp"
 #include "gtest/gtest.h"
 #include <Eigen/Core>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <set>
 
 using namespace jdf;
 using namespace nlohmann;
@@ -27,8 +35,23 @@ static const json columnJson = R"(
 )"_json;
 
 static const DataFrame dataFrame(columnJson);
+
+struct LabeledValue {
+    int value;
+    std::string label;
+    bool operator==(const LabeledValue&) const = default;
+};
 }
 
+// A converter written against the former json based Series.
+template <>
+struct jdf::SeriesConverter<LabeledValue> {
+    static LabeledValue convert(const json& data, std::string_view)
+    {
+        return { data["a"].get<int>(), data["s"].get<std::string>() };
+    }
+};
+
 TEST(DataFrame, iterateThroughDF)
 {
     size_t count = 1;
@@ -129,6 +152,18 @@ TEST(DataFrame, fromCsv)
     EXPECT_EQ(dataFrame.size(), 2);
     EXPECT_EQ(dataFrame.at(0).get<int>("x"), 1);
     EXPECT_EQ(dataFrame.at(1).get<int>("x"), 2);
+
+    std::stringstream padded;
+    padded << "a, b,c,d\n1, 2 ,\ttrue, x \n3,\t-4.5e1,false, y\n";
+    const auto paddedFrame = fromCsv(padded);
+    EXPECT_EQ(paddedFrame.column(" b").type(), ColumnType::Double);
+    EXPECT_EQ(paddedFrame.at(1).get<double>(" b"), -45.0);
+    EXPECT_EQ(paddedFrame.column("c").type(), ColumnType::Bool);
+    EXPECT_EQ(paddedFrame.at(0).get<std::string>("d"), " x ");
+
+    std::stringstream notNumbers;
+    notNumbers << "a\n1.e5\n";
+    EXPECT_EQ(fromCsv(notNumbers).at(0).get<std::string>("a"), "1.e5");
 }
 
 TEST(DataFrame, vector3fFromJsonObject)
@@ -165,3 +200,1090 @@ TEST(DataFrame, dataFrameWriter)
     EXPECT_EQ(df.at(2).get<int>("a"), 7);
     std::remove(path.c_str());
 }
+
+TEST(DataFrame, asyncDataFrameWriter)
+{
+    const std::string path = "AsyncDataFrameWriter_test.csv";
+    const auto readBack = [&] {
+        std::ifstream file(path);
+        return fromCsv(file);
+    };
+    {
+        AsyncDataFrameWriter writer(columnJson, path, { .flushRows = 1000, .flushInterval = std::chrono::milliseconds(10), .maxQueuedBatches = 2 });
+        for (int row = 0; row < 2500; row++) {
+            writer.addRow({ { "a", row }, { "b", row * 2 }, { "c", "x" } });
+        }
+        EXPECT_EQ(writer.rowCount(), 2502);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        EXPECT_EQ(readBack().size(), 2502);
+
+        writer.appendRows(R"([[1, 2, 3], [4, 5, 6]])"_json);
+    }
+    const DataFrame df = readBack();
+    ASSERT_EQ(df.size(), 2504);
+    EXPECT_EQ(df.at(0).get<int>("a"), 1);
+    EXPECT_EQ(df.at(2).get<int>("a"), 0);
+    EXPECT_EQ(df.at(2501).get<int>("b"), 4998);
+    EXPECT_EQ(df.at(2503).get<int>("c"), 6);
+    std::remove(path.c_str());
+}
+
+TEST(DataFrame, constructFromSplitFormat)
+{
+    const DataFrame df(splitJson);
+    EXPECT_EQ(df.size(), 2);
+    EXPECT_EQ(df.at(1).get<int>("a"), 4);
+    EXPECT_EQ(df.at(1).get<int>("c"), 6);
+}
+
+TEST(DataFrame, columnTypes)
+{
+    DataFrame df(R"({"i": [1, 2], "d": [1.5, 2], "s": ["x", "y"], "b": [true, false], "j": [1, "x"]})"_json);
+    EXPECT_EQ(df.column("i").type(), ColumnType::Int);
+    EXPECT_EQ(df.column("d").type(), ColumnType::Double);
+    EXPECT_EQ(df.column("s").type(), ColumnType::String);
+    EXPECT_EQ(df.column("b").type(), ColumnType::Bool);
+    EXPECT_EQ(df.column("j").type(), ColumnType::Json);
+
+    df.addRow({ { "i", 2.5 }, { "d", 3 }, { "s", "z" }, { "b", true }, { "j", 2 } });
+    EXPECT_EQ(df.column("i").type(), ColumnType::Double);
+    EXPECT_EQ(df.at(2).get<double>("i"), 2.5);
+    EXPECT_EQ(df.at(0).get<double>("i"), 1.0);
+    EXPECT_EQ(df.at(2).get<std::string>("s"), "z");
+}
+
+TEST(DataFrame, csvKeepsColumnOrder)
+{
+    std::stringstream in;
+    in << "z,a\n1,x\n";
+    const auto df = fromCsv(in);
+    EXPECT_EQ(df.column("a").type(), ColumnType::String);
+    std::stringstream out;
+    df.toCsv(out);
+    EXPECT_EQ(out.str(), "z,a\n1,\"x\"\n");
+}
+
+TEST(DataFrame, queryComparesColumns)
+{
+    const DataFrame df(R"({"a": [1, 5, 3], "b": [2.0, 4.0, 3.0], "s": ["x", "y", "z"]})"_json);
+    EXPECT_EQ(df.query("a"_c > "b"_c).size(), 1);
+    EXPECT_EQ(df.query("a"_c <= "b"_c).size(), 2);
+    EXPECT_EQ(df.query("a"_c >= 2.5).size(), 2);
+    EXPECT_EQ(df.query(3 < "a"_c).size(), 1);
+    EXPECT_EQ(df.query("s"_c == "y"_c).size(), 1);
+    EXPECT_EQ(df.query("s"_c != "y"_c && "a"_c != 3).first().get<std::string>("s"), "x");
+    EXPECT_EQ(df.query("s"_c == 1).size(), 0);
+    EXPECT_EQ(df.query("s"_c != 1).size(), 3);
+}
+
+TEST(DataFrame, queryWithNestedExpression)
+{
+    const DataFrame df(R"({"a": [1, 2, 3, 4, 5, 6]})"_json);
+    const auto filteredDF = df.query(("a"_c == 1 || ("a"_c > 2 && ("a"_c < 4 || "a"_c == 6))) || "a"_c == 5);
+    EXPECT_EQ(filteredDF.size(), 4);
+    EXPECT_EQ(filteredDF.at(1).get<int>("a"), 3);
+    EXPECT_EQ(filteredDF.at(3).get<int>("a"), 6);
+}
+
+TEST(DataFrame, queryLargeFrameMatchesScalarEvaluation)
+{
+    DataFrame df({ "i", "d", "b" });
+    for (int row = 0; row < 10000; row++) {
+        df.addRow({ { "i", (row * 7919) % 1000 }, { "d", ((row * 104729) % 1000) / 10.0 }, { "b", row % 3 == 0 } });
+    }
+
+    size_t expected = 0;
+    for (const auto& row : df) {
+        const int i = row.get<int>("i");
+        const double d = row.get<double>("d");
+        expected += (i >= 500 && d < 25.0) || (i == 7 && row.get<bool>("b"));
+    }
+    EXPECT_EQ(df.query(("i"_c >= 500 && "d"_c < 25.0) || ("i"_c == 7 && "b"_c == true)).size(), expected);
+
+    EXPECT_EQ(df.query("i"_c < 1000).size(), 10000);
+    EXPECT_EQ(df.query("i"_c > 998.5).size(), df.queryEq("i", 999).size());
+    EXPECT_EQ(df.query("d"_c <= 99.9).size(), 10000);
+    EXPECT_EQ(df.query("d"_c != 0).size() + df.queryEq("d", 0).size(), 10000);
+}
+
+TEST(DataFrame, rowViewReadsFromColumns)
+{
+    DataFrame df(R"({"a": [1, 2], "s": ["x", "y"]})"_json);
+    const auto row = df.at(1);
+    EXPECT_EQ(row.index(), 1);
+    EXPECT_EQ(&row.dataFrame(), &df);
+    EXPECT_EQ(row.get<std::string_view>("s"), "y");
+    EXPECT_EQ(row.data(), R"({"a": 2, "s": "y"})"_json);
+    EXPECT_EQ(row.get<LabeledValue>("a,s"), (LabeledValue { 2, "y" }));
+}
+
+TEST(DataFrame, fromCsvParsesQuotedFields)
+{
+    std::stringstream ss;
+    ss << "id,name,score,flag\r\n"
+       << "1,\"a, \"\"quoted\"\" name\",1.5,true\r\n"
+       << "\r\n"
+       << "007,\"multi\nline\",2,false\n";
+    const auto df = fromCsv(ss);
+    EXPECT_EQ(df.size(), 2);
+    EXPECT_EQ(df.column("id").type(), ColumnType::Json);
+    EXPECT_EQ(df.at(1).get<std::string>("id"), "007");
+    EXPECT_EQ(df.at(0).get<std::string>("name"), "a, \"quoted\" name");
+    EXPECT_EQ(df.at(1).get<std::string>("name"), "multi\nline");
+    EXPECT_EQ(df.column("score").type(), ColumnType::Double);
+    EXPECT_EQ(df.at(1).get<double>("score"), 2.0);
+    EXPECT_EQ(df.column("flag").type(), ColumnType::Bool);
+
+    std::stringstream shortRows;
+    shortRows << "a,b,c\n1,2\n3,4,5,6\n";
+    const auto padded = fromCsv(shortRows);
+    ASSERT_EQ(padded.size(), 2);
+    EXPECT_TRUE(padded.column("c").get(0).is_null());
+    EXPECT_EQ(padded.at(1).get<int>("c"), 5);
+
+    std::stringstream unterminated;
+    unterminated << "a,b\n1,\"open";
+    EXPECT_EQ(fromCsv(unterminated).at(0).get<std::string>("b"), "open");
+}
+
+TEST(DataFrame, fromCsvParsesLargeFilesInChunks)
+{
+    const std::string path = "DataFrameFromCsvChunks_test.csv";
+    const size_t rowCount = 200000;
+    {
+        std::ofstream file(path);
+        file << "i,s,d\n";
+        for (size_t row = 0; row < rowCount; row++) {
+            file << row << ",\"line " << row << (row % 1000 == 0 ? "\nwith, break" : "") << "\"," << row * 0.5 << "\n";
+        }
+    }
+    const DataFrame df = fromCsv(path);
+    std::remove(path.c_str());
+
+    ASSERT_EQ(df.size(), rowCount);
+    EXPECT_EQ(df.column("i").type(), ColumnType::Int);
+    EXPECT_EQ(df.column("s").type(), ColumnType::String);
+    EXPECT_EQ(df.column("d").type(), ColumnType::Double);
+    for (size_t row = 0; row < rowCount; row += 997) {
+        EXPECT_EQ(df.at(row).get<int64_t>("i"), row);
+        EXPECT_EQ(df.at(row).get<double>("d"), row * 0.5);
+    }
+    EXPECT_EQ(df.at(5000).get<std::string>("s"), "line 5000\nwith, break");
+    EXPECT_EQ(df.at(rowCount - 1).get<std::string>("s"), "line " + std::to_string(rowCount - 1));
+
+    // Quotes inside unquoted fields do not start a quoted field, also when the file is parsed in chunks.
+    std::stringstream strayQuotes;
+    strayQuotes << "i,size,s\n";
+    for (size_t row = 0; row < rowCount; row++) {
+        strayQuotes << row << ",12\",\"a \"\"b\"\" " << row << "\nend\"\n";
+    }
+    const auto quotes = fromCsv(strayQuotes);
+    ASSERT_EQ(quotes.size(), rowCount);
+    for (size_t row = 0; row < rowCount; row += 997) {
+        EXPECT_EQ(quotes.at(row).get<int64_t>("i"), row);
+        EXPECT_EQ(quotes.at(row).get<std::string>("size"), "12\"");
+    }
+    EXPECT_EQ(quotes.at(3000).get<std::string>("s"), "a \"b\" 3000\nend");
+}
+
+TEST(DataFrame, missingFilesThrow)
+{
+    const std::string path = "DataFrameMissing_test.csv";
+    std::filesystem::remove(path);
+    EXPECT_THROW(fromCsv(path), std::system_error);
+    EXPECT_THROW(fromJson(std::string_view(path)), std::system_error);
+    EXPECT_THROW(fromNdjson(std::string_view(path)), std::system_error);
+    EXPECT_THROW(mapBinary(path), std::system_error);
+}
+
+TEST(DataFrame, csvBatchReader)
+{
+    std::stringstream ss;
+    ss << "a,b\n";
+    for (int row = 0; row < 10; row++) {
+        ss << row << ",\"text\n" << row << "\"\n";
+    }
+    ss << "10,\"last\"";
+
+    CsvBatchReader reader(ss, 4);
+    EXPECT_EQ(reader.columnNames(), (std::vector<std::string> { "a", "b" }));
+    std::vector<size_t> batchSizes;
+    int64_t expected = 0;
+    while (const auto batch = reader.next()) {
+        batchSizes.push_back(batch->size());
+        EXPECT_EQ(batch->column("a").type(), ColumnType::Int);
+        for (const auto& row : *batch) {
+            EXPECT_EQ(row.get<int64_t>("a"), expected++);
+        }
+    }
+    EXPECT_EQ(batchSizes, (std::vector<size_t> { 4, 4, 3 }));
+    EXPECT_EQ(expected, 11);
+
+    // A quote inside an unquoted field is a literal character and doesn't start a quoted field.
+    std::stringstream stray;
+    stray << "a,b\n1,5\" tall\n";
+    for (int row = 0; row < 10; row++) {
+        stray << row << "," << row << "\n";
+    }
+    CsvBatchReader strayReader(stray, 2);
+    batchSizes.clear();
+    while (const auto batch = strayReader.next()) {
+        batchSizes.push_back(batch->size());
+        if (batchSizes.size() == 1) {
+            EXPECT_EQ(batch->at(0).value<std::string>("b"), "5\" tall");
+        }
+    }
+    EXPECT_EQ(batchSizes, (std::vector<size_t> { 2, 2, 2, 2, 2, 1 }));
+}
+
+TEST(DataFrame, toCsvRoundTrip)
+{
+    DataFrame df({ "i", "d", "b", "s", "j" });
+    for (int row = 0; row < 200000; row++) {
+        df.addRow({ { "i", row }, { "d", row * 0.25 }, { "b", row % 2 == 0 }, { "s", "a,\"" + std::to_string(row) + "\"" }, { "j", row % 2 == 0 ? json(row) : json("x") } });
+    }
+    std::stringstream ss;
+    df.toCsv(ss);
+    const auto csv = ss.str();
+    EXPECT_TRUE(csv.starts_with("i,d,b,s,j\n0,0.0,true,\"a,\"\"0\"\"\",0\n1,0.25,false,\"a,\"\"1\"\"\",\"x\"\n"));
+
+    const auto parsed = fromCsv(ss);
+    ASSERT_EQ(parsed.size(), df.size());
+    for (size_t col = 0; col < df.columnCount(); col++) {
+        EXPECT_EQ(parsed.column(col).type(), df.column(col).type());
+    }
+    for (size_t row = 0; row < df.size(); row += 1009) {
+        EXPECT_EQ(parsed.at(row).data(), df.at(row).data());
+    }
+}
+
+TEST(DataFrame, binaryRoundTrip)
+{
+    DataFrame df({ "i", "d", "b", "s", "j" });
+    for (int row = 0; row < 1000; row++) {
+        df.addRow({ { "i", row }, { "d", row * 0.5 }, { "b", row % 3 == 0 }, { "s", "s" + std::to_string(row) }, { "j", row % 2 == 0 ? json(row) : json("x") } });
+    }
+    const std::string path = std::filesystem::temp_directory_path() / "dataframe_test.jdf";
+    df.toBinary(path);
+
+    auto mapped = mapBinary(path);
+    ASSERT_EQ(mapped.size(), df.size());
+    EXPECT_EQ(mapped.columnNames(), df.columnNames());
+    for (size_t col = 0; col < df.columnCount(); col++) {
+        EXPECT_EQ(mapped.column(col).type(), df.column(col).type());
+    }
+    for (size_t row = 0; row < df.size(); row++) {
+        EXPECT_EQ(mapped.at(row).data(), df.at(row).data());
+    }
+    EXPECT_EQ(mapped.query("i"_c > 900).size(), 99);
+    EXPECT_EQ(mapped.queryEq("s", "s42").first().value<int>("i"), 42);
+
+    mapped.addRow({ { "i", 1000 }, { "d", 1.5 }, { "b", true }, { "s", "new" }, { "j", 1 } });
+    EXPECT_EQ(mapped.size(), 1001);
+    EXPECT_EQ(mapped.at(1000).value<std::string>("s"), "new");
+    EXPECT_EQ(mapped.at(999).value<std::string>("s"), "s999");
+
+    std::string content;
+    {
+        std::ifstream file(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    const auto mapsWithCorruption = [&](size_t size, size_t position, std::string_view replacement) {
+        std::string corrupted = content.substr(0, size);
+        corrupted.replace(position, replacement.size(), replacement);
+        std::ofstream(path, std::ios::binary) << corrupted;
+        mapBinary(path);
+    };
+    EXPECT_NO_THROW(mapsWithCorruption(content.size(), 0, ""));
+    EXPECT_THROW(mapsWithCorruption(content.size(), 0, "NOTBIN"), std::invalid_argument);
+    EXPECT_THROW(mapsWithCorruption(content.size(), 6, "02"), std::invalid_argument);
+    EXPECT_THROW(mapsWithCorruption(content.size() - 100, 0, ""), std::invalid_argument);
+    EXPECT_THROW(mapsWithCorruption(10, 0, ""), std::invalid_argument);
+    EXPECT_THROW(mapsWithCorruption(content.size(), 16, "{\"rows\":"), std::invalid_argument);
+    const size_t rows = content.find("\"rows\":1000");
+    ASSERT_NE(rows, std::string::npos);
+    EXPECT_THROW(mapsWithCorruption(content.size(), rows, "\"rows\":2000"), std::invalid_argument);
+    std::filesystem::remove(path);
+}
+
+TEST(DataFrame, hashIndex)
+{
+    DataFrame df({ "id", "name", "value" });
+    for (int row = 0; row < 10000; row++) {
+        df.addRow({ { "id", row % 100 }, { "name", "n" + std::to_string(row % 7) }, { "value", row } });
+    }
+    df.createIndex("id");
+    df.createIndex("name");
+
+    const auto byId = df.queryEq("id", 42);
+    ASSERT_EQ(byId.size(), 100);
+    EXPECT_EQ(byId.at(0).value<int>("value"), 42);
+    EXPECT_EQ(byId.at(99).value<int>("value"), 9942);
+    EXPECT_EQ(df.queryEq("id", 100).size(), 0);
+    EXPECT_EQ(df.queryEq("id", "42").size(), 0);
+    EXPECT_EQ(df.queryEq("id", 42.0).size(), 100);
+    EXPECT_EQ(df.query("id"_c == 42 && "name"_c == "n0").size(), 15);
+    EXPECT_EQ(df.query("id"_c == 42 || "value"_c < 10).size(), 110);
+
+    df.addRow({ { "id", 42 }, { "name", "new" }, { "value", -1 } });
+    EXPECT_EQ(df.queryEq("id", 42).size(), 101);
+    EXPECT_EQ(df.queryEq("name", "new").first().value<int>("value"), -1);
+
+    // Widening the column rebuilds the index.
+    df.addRow({ { "id", 42.5 }, { "name", "new" }, { "value", -2 } });
+    EXPECT_EQ(df.queryEq("id", 42).size(), 101);
+    EXPECT_EQ(df.queryEq("id", 42.5).first().value<int>("value"), -2);
+}
+
+TEST(DataFrame, rangeQueriesUseZoneMapsAndSortedIndex)
+{
+    DataFrame df({ "time", "value", "name" });
+    for (int row = 0; row < 50000; row++) {
+        const double value = row % 1000 == 7 ? std::nan("") : (row * 7919) % 10007 / 10.0;
+        df.addRow({ { "time", 1000 + row }, { "value", value }, { "name", "n" + std::to_string(row % 977) } });
+    }
+    const auto countRows = [&](const auto& predicate) {
+        size_t count = 0;
+        for (size_t row = 0; row < df.size(); row++) {
+            count += predicate(row);
+        }
+        return count;
+    };
+    const auto time = [&](size_t row) { return df.column("time").values<int64_t>()[row]; };
+    const auto value = [&](size_t row) { return df.column("value").values<double>()[row]; };
+
+    const auto checkQueries = [&] {
+        EXPECT_EQ(df.query("time"_c >= 5000 && "time"_c < 5100).size(), 100);
+        EXPECT_EQ(df.query("time"_c > 100000).size(), 0);
+        EXPECT_EQ(df.query("time"_c >= 1000).size(), df.size());
+        EXPECT_EQ(df.query("time"_c <= 20000.5).size(), 19001);
+        EXPECT_EQ(df.query("value"_c < 100.0).size(), countRows([&](size_t row) { return value(row) < 100.0; }));
+        EXPECT_EQ(df.query("value"_c != 0.0).size(), countRows([&](size_t row) { return value(row) != 0.0; }));
+        EXPECT_EQ(df.query("name"_c <= "n1").size(), countRows([&](size_t row) { return df.column("name").string(row) <= "n1"; }));
+        EXPECT_EQ(df.query("time"_c < 1500 || "value"_c >= 1000.0).size(), countRows([&](size_t row) { return time(row) < 1500 || value(row) >= 1000.0; }));
+    };
+    checkQueries();
+    df.createSortedIndex("time");
+    df.createSortedIndex("value");
+    df.createSortedIndex("name");
+    checkQueries();
+
+    df.addRow({ { "time", 1050 }, { "value", -1.0 }, { "name", "a" } });
+    EXPECT_EQ(df.query("time"_c < 1051).size(), 52);
+    EXPECT_EQ(df.query("value"_c < 0).first().value<int>("time"), 1050);
+    EXPECT_EQ(df.query("name"_c < "b").size(), 1);
+
+    // A batch of rows out of order is merged into the index.
+    json rows = json::array();
+    for (int row = 0; row < 2000; row++) {
+        rows.push_back({ { "time", 3000 - row / 2 }, { "value", row % 3 - 2.0 }, { "name", "m" + std::to_string(row % 10) } });
+    }
+    df.appendRows(rows);
+    EXPECT_EQ(df.query("time"_c >= 2000 && "time"_c < 2010).size(), 10 + 18);
+    EXPECT_EQ(df.query("value"_c < -1.5).size(), 667);
+    EXPECT_EQ(df.query("value"_c < 100.0).size(), countRows([&](size_t row) { return value(row) < 100.0; }));
+    EXPECT_EQ(df.query("name"_c <= "n1").size(), countRows([&](size_t row) { return df.column("name").string(row) <= "n1"; }));
+}
+
+TEST(DataFrame, chainedQueriesOnView)
+{
+    DataFrame df({ "a", "b", "s" });
+    for (int row = 0; row < 20000; row++) {
+        df.addRow({ { "a", row % 100 }, { "b", row }, { "s", "s" + std::to_string(row % 3) } });
+    }
+    const auto view = df.view().query("a"_c < 10).query("s"_c == "s0").queryEq("a", 3);
+    const auto expected = df.query("a"_c < 10 && "s"_c == "s0" && "a"_c == 3);
+    ASSERT_EQ(view.size(), expected.size());
+    size_t index = 0;
+    for (const auto row : view) {
+        EXPECT_EQ(row.data(), expected.at(index++).data());
+    }
+
+    const auto sparse = view.query("b"_c > 10000);
+    EXPECT_EQ(sparse.size(), df.query("a"_c == 3 && "s"_c == "s0" && "b"_c > 10000).size());
+    EXPECT_EQ(sparse.first().value<int>("a"), 3);
+    EXPECT_EQ(sparse.materialize().size(), sparse.size());
+    EXPECT_EQ(view.queryEq("missing", 1).size(), 0);
+
+    std::stringstream viewCsv;
+    std::stringstream expectedCsv;
+    view.toCsv(viewCsv);
+    expected.toCsv(expectedCsv);
+    EXPECT_EQ(viewCsv.str(), expectedCsv.str());
+}
+
+TEST(DataFrame, parallelQuery)
+{
+    DataFrame df({ "a", "b" });
+    for (int row = 0; row < 200000; row++) {
+        df.addRow({ { "a", row % 1000 }, { "b", (row * 31) % 977 * 0.5 } });
+    }
+    const auto sequential = df.query("a"_c < 500 && "b"_c >= 100.0);
+
+    ThreadPool::setGlobalThreadCount(4);
+    const auto parallel = df.query("a"_c < 500 && "b"_c >= 100.0);
+    ASSERT_EQ(parallel.size(), sequential.size());
+    for (size_t row = 0; row < parallel.size(); row += 101) {
+        EXPECT_EQ(parallel.at(row).data(), sequential.at(row).data());
+    }
+    EXPECT_EQ(df.view().query("a"_c == 7).size(), 200);
+
+    std::atomic<int64_t> sum = 0;
+    df.parallelForEach([&](const RowView& row) { sum += row.value<int64_t>("a"); });
+    EXPECT_EQ(sum, 200 * 499500);
+    ThreadPool::setGlobalThreadCount(std::thread::hardware_concurrency());
+}
+
+TEST(DataFrame, threadPoolPropagatesExceptions)
+{
+    ThreadPool pool(4);
+    std::atomic<size_t> calls = 0;
+    EXPECT_THROW(pool.run(1000, [&](size_t i) {
+        calls++;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        if (i == 10) {
+            throw std::runtime_error("task failed");
+        }
+    }),
+        std::runtime_error);
+    EXPECT_LT(calls, 1000);
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    pool.run(16, [&](size_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+    EXPECT_GT(threads.size(), 1);
+}
+
+TEST(DataFrame, groupByAggregates)
+{
+    DataFrame df({ "city", "year", "price", "rooms", "note" });
+    df.addRow({ { "city", "Berlin" }, { "year", 2020 }, { "price", 10.0 }, { "rooms", 2 }, { "note", "a" } });
+    df.addRow({ { "city", "Paris" }, { "year", 2020 }, { "price", 20.0 }, { "rooms", 3 }, { "note", nullptr } });
+    df.addRow({ { "city", "Berlin" }, { "year", 2021 }, { "price", 30.0 }, { "rooms", 4 }, { "note", 1 } });
+    df.addRow({ { "city", "Berlin" }, { "year", 2020 }, { "price", std::nan("") }, { "rooms", 1 }, { "note", "b" } });
+
+    const auto byCity = df.groupBy({ "city" }).agg({ { "price", Aggregation::Sum }, { "price", Aggregation::Mean }, { "rooms", Aggregation::Max }, { "note", Aggregation::Count } });
+    EXPECT_EQ(byCity.columnNames(), (std::vector<std::string> { "city", "price_sum", "price_mean", "rooms_max", "note_count" }));
+    ASSERT_EQ(byCity.size(), 2);
+    EXPECT_EQ(byCity.at(0).value<std::string>("city"), "Berlin");
+    EXPECT_EQ(byCity.at(0).value<double>("price_sum"), 40.0);
+    EXPECT_EQ(byCity.at(0).value<double>("price_mean"), 20.0);
+    EXPECT_EQ(byCity.column("rooms_max").type(), ColumnType::Int);
+    EXPECT_EQ(byCity.at(0).value<int>("rooms_max"), 4);
+    EXPECT_EQ(byCity.at(0).value<int>("note_count"), 3);
+    EXPECT_EQ(byCity.at(1).value<int>("note_count"), 0);
+
+    const auto byCityAndYear = df.groupBy({ "city", "year" }).agg({ { "rooms", Aggregation::Sum }, { "price", Aggregation::Min } });
+    ASSERT_EQ(byCityAndYear.size(), 3);
+    EXPECT_EQ(byCityAndYear.at(0).value<int>("rooms_sum"), 3);
+    EXPECT_EQ(byCityAndYear.at(0).value<double>("price_min"), 10.0);
+    EXPECT_EQ(byCityAndYear.at(2).value<int>("year"), 2021);
+
+    const DataFrame mixed(R"({"key": [1, "a", 1.0, 2], "value": [1, 2, 3, 4]})"_json);
+    ASSERT_EQ(mixed.column("key").type(), ColumnType::Json);
+    const auto byMixed = mixed.groupBy({ "key" }).agg({ { "value", Aggregation::Sum } });
+    ASSERT_EQ(byMixed.size(), 3);
+    EXPECT_EQ(byMixed.at(0).value<int>("value_sum"), 4);
+
+    // A parsed integer is stored as unsigned json, it has to group with the equal int64_t.
+    DataFrame large(R"({"key": ["a", 9007199254740993], "value": [1, 2]})"_json);
+    large.addRow({ { "key", int64_t(9007199254740993) }, { "value", 3 } });
+    const auto byLarge = large.groupBy({ "key" }).agg({ { "value", Aggregation::Sum } });
+    ASSERT_EQ(byLarge.size(), 2);
+    EXPECT_EQ(byLarge.at(1).value<int>("value_sum"), 5);
+
+    const DataFrame empty({ "key", "value" });
+    const auto byEmpty = empty.groupBy({ "key" }).agg({ { "value", Aggregation::Sum }, { "value", Aggregation::Count } });
+    EXPECT_EQ(byEmpty.size(), 0);
+    EXPECT_EQ(byEmpty.columnNames(), (std::vector<std::string> { "key", "value_sum", "value_count" }));
+    EXPECT_THROW(df.groupBy({ "city" }).agg({ { "price", Aggregation::Sum }, { "price", Aggregation::Sum } }), std::invalid_argument);
+
+    // Nulls in an aggregated column are skipped, other values that are not numbers can't be aggregated.
+    const DataFrame withNull(R"({"k": ["a", "a", "b"], "v": [1, null, 3]})"_json);
+    const auto byK = withNull.groupBy({ "k" }).agg({ { "v", Aggregation::Sum }, { "v", Aggregation::Mean }, { "v", Aggregation::Max }, { "v", Aggregation::Count } });
+    ASSERT_EQ(byK.size(), 2);
+    EXPECT_EQ(byK.at(0).value<double>("v_sum"), 1.0);
+    EXPECT_EQ(byK.at(0).value<double>("v_mean"), 1.0);
+    EXPECT_EQ(byK.at(1).value<double>("v_max"), 3.0);
+    EXPECT_EQ(byK.at(0).value<int>("v_count"), 1);
+    EXPECT_THROW(df.groupBy({ "city" }).agg({ { "note", Aggregation::Sum } }), std::invalid_argument);
+    EXPECT_THROW(df.groupBy({ "year" }).agg({ { "city", Aggregation::Min } }), std::invalid_argument);
+    EXPECT_EQ(df.groupBy({ "year" }).agg({ { "city", Aggregation::Count } }).at(0).value<int>("city_count"), 3);
+}
+
+TEST(DataFrame, groupByMergesPartialTables)
+{
+    DataFrame df({ "key", "value" });
+    for (int row = 0; row < 200000; row++) {
+        df.addRow({ { "key", (row * 7) % 1000 }, { "value", row } });
+    }
+    ThreadPool::setGlobalThreadCount(3);
+    const auto grouped = df.groupBy({ "key" }).agg({ { "value", Aggregation::Count }, { "value", Aggregation::Sum }, { "value", Aggregation::Min } });
+    ThreadPool::setGlobalThreadCount(std::thread::hardware_concurrency());
+    ASSERT_EQ(grouped.size(), 1000);
+    int64_t total = 0;
+    for (size_t group = 0; group < grouped.size(); group++) {
+        EXPECT_EQ(grouped.at(group).value<int>("key"), (group * 7) % 1000);
+        EXPECT_EQ(grouped.at(group).value<int>("value_count"), 200);
+        EXPECT_EQ(grouped.at(group).value<int>("value_min"), group);
+        total += grouped.at(group).value<int64_t>("value_sum");
+    }
+    EXPECT_EQ(total, int64_t { 200000 } * 199999 / 2);
+}
+
+TEST(DataFrame, joinInnerAndLeft)
+{
+    DataFrame events({ "id", "city", "value" });
+    events.addRow({ { "id", 1 }, { "city", 10 }, { "value", 1.5 } });
+    events.addRow({ { "id", 2 }, { "city", 20 }, { "value", 2.5 } });
+    events.addRow({ { "id", 3 }, { "city", 30 }, { "value", 3.5 } });
+    events.addRow({ { "id", 4 }, { "city", 10 }, { "value", 4.5 } });
+    DataFrame cities({ "city", "name", "value" });
+    cities.addRow({ { "city", 10.0 }, { "name", "Berlin" }, { "value", 1 } });
+    cities.addRow({ { "city", 20 }, { "name", "Paris" }, { "value", 2 } });
+    cities.addRow({ { "city", 20 }, { "name", "Paris 2" }, { "value", 3 } });
+
+    for (const auto& [left, right] : { std::pair { &events, &cities }, std::pair { &cities, &events } }) {
+        const auto inner = left->join(*right, { "city" });
+        EXPECT_EQ(inner.size(), 4);
+    }
+
+    const auto inner = events.join(cities, { "city" });
+    EXPECT_EQ(inner.columnNames(), (std::vector<std::string> { "id", "city", "value", "name", "value_right" }));
+    ASSERT_EQ(inner.size(), 4);
+    EXPECT_EQ(inner.at(0).value<std::string>("name"), "Berlin");
+    EXPECT_EQ(inner.at(1).value<std::string>("name"), "Paris");
+    EXPECT_EQ(inner.at(2).value<std::string>("name"), "Paris 2");
+    EXPECT_EQ(inner.at(3).value<int>("id"), 4);
+
+    const auto left = events.join(cities, { "city" }, JoinType::Left);
+    ASSERT_EQ(left.size(), 5);
+    EXPECT_EQ(left.at(3).value<int>("id"), 3);
+    EXPECT_TRUE(left.at(3).data()["name"].is_null());
+    EXPECT_EQ(left.at(4).value<std::string>("name"), "Berlin");
+
+    const auto reversed = cities.join(events, { "city" }, JoinType::Left);
+    ASSERT_EQ(reversed.size(), 4);
+    EXPECT_EQ(reversed.at(0).value<int>("id"), 1);
+    EXPECT_EQ(reversed.at(1).value<int>("id"), 4);
+    EXPECT_EQ(reversed.at(3).value<std::string>("name"), "Paris 2");
+
+    const DataFrame parsedKeys(R"({"key": ["a", 9007199254740993]})"_json);
+    DataFrame intKeys(std::vector<std::string> { "key" });
+    intKeys.addRow({ { "key", int64_t(9007199254740993) } });
+    EXPECT_EQ(parsedKeys.join(intKeys, { "key" }).size(), 1);
+    EXPECT_EQ(intKeys.join(parsedKeys, { "key" }).size(), 1);
+
+    DataFrame large({ "key", "row" });
+    for (int row = 0; row < 100000; row++) {
+        large.addRow({ { "key", row % 5000 }, { "row", row } });
+    }
+    DataFrame small({ "key", "label" });
+    for (int key = 0; key < 6000; key += 2) {
+        small.addRow({ { "key", key }, { "label", "k" + std::to_string(key) } });
+    }
+    const auto joined = large.join(small, { "key" }, JoinType::Left);
+    ASSERT_EQ(joined.size(), large.size());
+    for (size_t row = 0; row < joined.size(); row += 997) {
+        EXPECT_EQ(joined.at(row).value<int>("row"), row);
+        const int key = row % 5000;
+        EXPECT_EQ(joined.at(row).data()["label"], key % 2 == 0 ? json("k" + std::to_string(key)) : json());
+    }
+    EXPECT_EQ(small.join(large, { "key" }).size(), 2500 * 20);
+}
+
+TEST(DataFrame, sortByAndTopK)
+{
+    DataFrame df({ "group", "value", "name" });
+    const std::vector<double> values = { 3.5, -1.0, std::nan(""), 3.5, 0.0, -7.25, 10.0 };
+    for (size_t row = 0; row < values.size(); row++) {
+        df.addRow({ { "group", static_cast<int>(row % 2) }, { "value", values[row] }, { "name", "n" + std::to_string(values.size() - row) } });
+    }
+
+    const auto byValue = df.sortBy({ "value" });
+    const std::vector<int> ascendingNames = { 2, 6, 3, 7, 4, 1 };
+    for (size_t row = 0; row < ascendingNames.size(); row++) {
+        EXPECT_EQ(byValue.at(row).value<std::string>("name"), "n" + std::to_string(ascendingNames[row]));
+    }
+    EXPECT_TRUE(std::isnan(byValue.at(6).value<double>("value")));
+
+    const auto descending = df.sortBy({ "value" }, false);
+    EXPECT_EQ(descending.at(0).value<double>("value"), 10.0);
+    EXPECT_EQ(descending.at(1).value<std::string>("name"), "n7");
+    EXPECT_EQ(descending.at(2).value<std::string>("name"), "n4");
+    EXPECT_TRUE(std::isnan(descending.at(6).value<double>("value")));
+
+    const auto byGroupAndValue = df.sortBy({ "group", "value" });
+    EXPECT_EQ(byGroupAndValue.at(0).value<double>("value"), 0.0);
+    EXPECT_EQ(byGroupAndValue.at(3).value<int>("group"), 0);
+    EXPECT_TRUE(std::isnan(byGroupAndValue.at(3).value<double>("value")));
+    EXPECT_EQ(byGroupAndValue.at(4).value<double>("value"), -7.25);
+
+    const auto byName = df.sortBy({ "name" }, false);
+    EXPECT_EQ(byName.at(0).value<std::string>("name"), "n7");
+    EXPECT_EQ(byName.at(6).value<std::string>("name"), "n1");
+
+    const auto top = df.topK("value", 3);
+    ASSERT_EQ(top.size(), 3);
+    EXPECT_EQ(top.at(0).value<double>("value"), 10.0);
+    EXPECT_EQ(top.at(1).value<std::string>("name"), "n7");
+    EXPECT_EQ(top.at(2).value<std::string>("name"), "n4");
+    EXPECT_EQ(df.topK("value", 100).size(), df.size());
+
+    DataFrame large({ "key", "label" });
+    for (int row = 0; row < 100000; row++) {
+        large.addRow({ { "key", (row * 7919) % 100003 - 50000 }, { "label", "l" + std::to_string((row * 31) % 1000) } });
+    }
+    ThreadPool::setGlobalThreadCount(3);
+    for (const auto& columns : { std::vector<std::string> { "key" }, std::vector<std::string> { "label", "key" } }) {
+        const auto sorted = large.sortBy(columns);
+        for (size_t row = 1; row < sorted.size(); row++) {
+            const auto previous = sorted.at(row - 1);
+            const auto current = sorted.at(row);
+            const auto key = [&](const RowView& view) {
+                return columns.size() == 1 ? std::pair { std::string(), view.value<int>("key") } : std::pair { view.value<std::string>("label"), view.value<int>("key") };
+            };
+            ASSERT_LE(key(previous), key(current));
+        }
+    }
+    ThreadPool::setGlobalThreadCount(std::thread::hardware_concurrency());
+}
+
+TEST(DataFrame, appendRowsAndConcat)
+{
+    DataFrame df({ "a", "b" });
+    df.reserve(1000);
+    df.createIndex("a");
+    df.appendRows(R"([{"a": 1, "b": "x"}, {"b": "y", "a": 2}, [3, "z"]])"_json);
+    df.appendRows(R"({"a": [4, 5.5], "b": ["u", "v"]})"_json);
+    ASSERT_EQ(df.size(), 5);
+    EXPECT_EQ(df.column("a").type(), ColumnType::Double);
+    EXPECT_EQ(df.at(1).value<std::string>("b"), "y");
+    EXPECT_EQ(df.at(2).value<int>("a"), 3);
+    EXPECT_EQ(df.at(4).value<double>("a"), 5.5);
+    EXPECT_EQ(df.queryEq("a", 4).first().value<std::string>("b"), "u");
+
+    DataFrame other({ "b", "a" });
+    other.addRow({ { "a", 6 }, { "b", "w" } });
+    std::vector<DataFrame> frames;
+    frames.push_back(std::move(df));
+    frames.push_back(other);
+    frames.push_back(other);
+    const auto combined = concat(std::move(frames));
+    EXPECT_EQ(combined.columnNames(), (std::vector<std::string> { "a", "b" }));
+    ASSERT_EQ(combined.size(), 7);
+    EXPECT_EQ(combined.at(6).value<double>("a"), 6.0);
+    EXPECT_EQ(combined.at(5).value<std::string>("b"), "w");
+    EXPECT_EQ(combined.queryEq("a", 6).size(), 2);
+}
+
+TEST(DataFrame, eigenMatrixExport)
+{
+    DataFrame df({ "x", "y", "z", "flag" });
+    for (int row = 0; row < 100; row++) {
+        df.addRow({ { "x", row }, { "y", row * 0.5 }, { "z", -row }, { "flag", row % 2 == 0 } });
+    }
+
+    const Eigen::Matrix<float, Eigen::Dynamic, 3> points = df.toMatrix<float, 3>("x,y,z");
+    ASSERT_EQ(points.rows(), 100);
+    EXPECT_EQ(points.row(10), Eigen::RowVector3f(10.0f, 5.0f, -10.0f));
+    const auto inferred = df.toMatrix<float>({ "x", "y", "z" });
+    static_assert(std::is_same_v<std::decay_t<decltype(inferred)>, Eigen::Matrix<float, Eigen::Dynamic, 3>>);
+    EXPECT_EQ(inferred, points);
+    static_assert(decltype(df.toMatrix<float>({ "x", "y" }))::ColsAtCompileTime == 2);
+
+    const Eigen::MatrixXd all = df.toMatrix<double>("z,flag");
+    ASSERT_EQ(all.cols(), 2);
+    EXPECT_EQ(all(3, 0), -3.0);
+    EXPECT_EQ(all(4, 1), 1.0);
+
+    const auto y = df.columnMap<double>("y");
+    EXPECT_EQ(y.data(), df.column("y").values<double>().data());
+    EXPECT_EQ(y.sum(), 0.5 * 4950);
+}
+
+TEST(DataFrame, typedDataFrame)
+{
+    using Points = TypedDataFrame<Field<"x", float>, Field<"y", double>, Field<"label", std::string>, Field<"valid", bool>>;
+    static_assert(Points::indexOf<"label">() == 2);
+    static_assert(Points::indexOf<"missing">() == Points::columnCount);
+
+    DataFrame df({ "label", "x", "y", "valid", "extra" });
+    for (int row = 0; row < 10; row++) {
+        df.addRow({ { "label", "p" + std::to_string(row) }, { "x", row }, { "y", row * 0.5 }, { "valid", row % 2 == 0 }, { "extra", nullptr } });
+    }
+
+    Points points(df);
+    ASSERT_EQ(points.size(), 10);
+    EXPECT_EQ(points.get<"x">(3), 3.0f);
+    EXPECT_EQ(points.get<"label">(3), "p3");
+    EXPECT_TRUE(points.get<"valid">(4));
+
+    double sum = 0.0;
+    for (const auto& [x, y, label, valid] : points) {
+        sum += x + y;
+    }
+    EXPECT_EQ(sum, 45.0 * 1.5);
+
+    struct Point {
+        float x;
+        double y;
+        std::string label;
+        bool valid;
+    };
+    const auto point = points.as<Point>(5);
+    EXPECT_EQ(point.label, "p5");
+    EXPECT_FALSE(point.valid);
+
+    points.addRow(1.5f, 2.5, "new", true);
+    size_t validCount = 0;
+    points.forEach([&](float, double, const std::string&, bool valid) { validCount += valid; });
+    EXPECT_EQ(validCount, 6);
+
+    const auto converted = points.toDataFrame();
+    EXPECT_EQ(converted.columnNames(), (std::vector<std::string> { "x", "y", "label", "valid" }));
+    EXPECT_EQ(converted.column("x").type(), ColumnType::Double);
+    EXPECT_EQ(converted.column("valid").type(), ColumnType::Bool);
+    EXPECT_EQ(converted.at(10).value<std::string>("label"), "new");
+    EXPECT_EQ(converted.at(10).value<double>("x"), 1.5);
+
+    using Flags = TypedDataFrame<Field<"i", bool>, Field<"d", bool>>;
+    DataFrame numbers({ "i", "d" });
+    numbers.addRow({ { "i", 256 }, { "d", 0.5 } });
+    numbers.addRow({ { "i", 0 }, { "d", 0.0 } });
+    const Flags flags(numbers);
+    EXPECT_TRUE(flags.get<"i">(0));
+    EXPECT_TRUE(flags.get<"d">(0));
+    EXPECT_FALSE(flags.get<"i">(1));
+    EXPECT_FALSE(flags.get<"d">(1));
+}
+
+TEST(DataFrame, dictionaryEncoding)
+{
+    std::stringstream in;
+    in << "level,message\n";
+    for (int row = 0; row < 1000; row++) {
+        in << (row % 3 == 0 ? "error" : "info") << ",message " << row << "\n";
+    }
+    auto df = fromCsv(in);
+    ASSERT_TRUE(df.column("level").strings().isDictionary());
+    EXPECT_EQ(df.column("level").strings().dictionary().values.size(), 2);
+    EXPECT_FALSE(df.column("message").strings().isDictionary());
+
+    EXPECT_EQ(df.queryEq("level", "error").size(), 334);
+    EXPECT_EQ(df.query("level"_c != "error").size(), 666);
+    EXPECT_EQ(df.query("level"_c == "warning").size(), 0);
+    EXPECT_EQ(df.query("level"_c > "error").size(), 666);
+
+    df.addRow({ { "level", "warning" }, { "message", "new" } });
+    EXPECT_EQ(df.column("level").strings().dictionary().values.size(), 3);
+    EXPECT_EQ(df.queryEq("level", "warning").first().value<std::string>("message"), "new");
+
+    const auto counts = df.groupBy({ "level" }).agg({ { "message", Aggregation::Count } });
+    ASSERT_EQ(counts.size(), 3);
+    EXPECT_EQ(counts.at(0).value<std::string>("level"), "error");
+    EXPECT_EQ(counts.at(1).value<int>("message_count"), 666);
+
+    auto errors = df.queryEq("level", "error");
+    errors.addRow({ { "level", "info" }, { "message", "existing level" } });
+    EXPECT_EQ(&errors.column("level").strings().dictionary(), &df.column("level").strings().dictionary());
+    errors.addRow({ { "level", "debug" }, { "message", "new level" } });
+    EXPECT_NE(&errors.column("level").strings().dictionary(), &df.column("level").strings().dictionary());
+    EXPECT_EQ(df.column("level").strings().dictionary().values.size(), 3);
+
+    df.encodeDictionary("message");
+    EXPECT_EQ(df.queryEq("message", "message 42").first().value<std::string>("level"), "error");
+}
+
+TEST(DataFrame, memoryUsageAndProfiling)
+{
+    Profiler profiler;
+    Profiler::install(&profiler);
+
+    std::stringstream in;
+    in << "level,value\n";
+    for (int row = 0; row < 1000; row++) {
+        in << "\"a rather long log level name " << row % 2 << "\"," << row << "\n";
+    }
+    auto df = fromCsv(in);
+    const auto filtered = df.query("value"_c < 100);
+    std::stringstream out;
+    filtered.toCsv(out);
+
+    Profiler::install(nullptr);
+    df.query("value"_c < 100);
+
+    const auto profiles = profiler.toJson();
+    ASSERT_EQ(profiles.size(), 3);
+    EXPECT_EQ(profiles[0]["operation"], "fromCsv");
+    EXPECT_EQ(profiles[0]["rowsEmitted"], 1000);
+    EXPECT_EQ(profiles[0]["bytesRead"], in.str().size());
+    EXPECT_EQ(profiles[1]["operation"], "query");
+    EXPECT_EQ(profiles[1]["rowsScanned"], 1000);
+    EXPECT_EQ(profiles[1]["rowsEmitted"], 100);
+    EXPECT_EQ(profiles[1]["stages"][0]["name"], "filter");
+    EXPECT_EQ(profiles[1]["stages"][1]["name"], "gather");
+    EXPECT_EQ(profiles[2]["operation"], "toCsv");
+    EXPECT_EQ(profiles[2]["bytesWritten"], out.str().size());
+
+    const auto usage = df.memoryUsage();
+    EXPECT_GE(usage["columns"]["value"].get<size_t>(), 1000 * sizeof(int64_t));
+    const size_t encodedSize = usage["columns"]["level"];
+    EXPECT_LT(encodedSize, 1000 * sizeof(uint32_t) + 1024);
+    EXPECT_EQ(usage["indices"], 0);
+
+    const auto decoded = DataFrame(std::vector<std::string> { "level" }, { Column(Column::Storage(StringBuffer(std::vector<std::string>(1000, "a rather long log level name")))) });
+    EXPECT_GT(decoded.memoryUsage()["total"].get<size_t>(), 1000 * 32);
+
+    df.createIndex("value");
+    EXPECT_GT(df.memoryUsage()["indices"].get<size_t>(), 0);
+    EXPECT_EQ(df.memoryUsage()["total"], df.memoryUsage()["indices"].get<size_t>() + usage["total"].get<size_t>());
+}
+
+TEST(DataFrame, streamingJsonAndMoveConstruction)
+{
+    const std::string path = "DataFrameStreamingJson_test.json";
+    const auto readFile = [&](const std::string& text) {
+        std::ofstream(path) << text;
+        return fromJson(std::string_view(path));
+    };
+
+    const auto split = readFile(R"({"data": [[1, "x", {"k": [1, 2]}], [2, "y", null]], "columns": ["a", "s", "nested"]})");
+    ASSERT_EQ(split.size(), 2);
+    EXPECT_EQ(split.columnNames(), (std::vector<std::string> { "a", "s", "nested" }));
+    EXPECT_EQ(split.column("a").type(), ColumnType::Int);
+    EXPECT_EQ(split.at(1).value<std::string>("s"), "y");
+    EXPECT_EQ(split.column("nested").get(0), R"({"k": [1, 2]})"_json);
+
+    const json columnFormat = R"({"b": [1.5, 2, true], "a": ["x", "y", "z"], "data": [[1], [2], [3]]})"_json;
+    const auto columns = readFile(columnFormat.dump());
+    const DataFrame expected(columnFormat);
+    EXPECT_EQ(columns.columnNames(), expected.columnNames());
+    for (size_t column = 0; column < expected.columnCount(); column++) {
+        EXPECT_EQ(columns.column(column).type(), expected.column(column).type());
+        for (size_t row = 0; row < expected.size(); row++) {
+            EXPECT_EQ(columns.column(column).get(row), expected.column(column).get(row));
+        }
+    }
+
+    EXPECT_EQ(readFile(R"(["a", "b"])").columnNames(), (std::vector<std::string> { "a", "b" }));
+    EXPECT_THROW(readFile(R"({"a": [1, 2)"), json::parse_error);
+
+    for (const auto* text : { R"({"data": [1, 2, 3], "x": [4, 5, 6]})", R"({"data": [[1, 2], [3]], "x": [4, 5]})", R"({"x": [4, 5], "data": [[1], {"k": 2}]})" }) {
+        const auto dataColumn = readFile(text);
+        const DataFrame expectedData(json::parse(text));
+        ASSERT_EQ(dataColumn.size(), expectedData.size());
+        for (size_t row = 0; row < expectedData.size(); row++) {
+            EXPECT_EQ(dataColumn.at(row).data(), expectedData.at(row).data());
+        }
+    }
+    EXPECT_THROW(readFile(R"({"columns": ["a", "b"], "data": [[1, 2], [3]]})"), std::invalid_argument);
+    EXPECT_THROW(readFile(R"({"columns": ["a"], "data": [1, 2]})"), std::invalid_argument);
+    EXPECT_THROW(readFile(R"({"a": [1, 2], "b": [3]})"), std::invalid_argument);
+    EXPECT_THROW(readFile(R"({"a": 1})"), std::invalid_argument);
+    EXPECT_THROW(readFile(R"({"a": {"b": [1]}})"), std::invalid_argument);
+    EXPECT_THROW(readFile(R"(["a", ["b"]])"), std::invalid_argument);
+    std::remove(path.c_str());
+
+    json data = R"({"columns": ["s", "j"], "data": [["a long string value", [1, 2]], ["b", {"x": 1}]]})"_json;
+    const DataFrame moved(std::move(data));
+    EXPECT_EQ(moved.at(0).value<std::string>("s"), "a long string value");
+    EXPECT_EQ(moved.column("j").get(1), R"({"x": 1})"_json);
+    EXPECT_TRUE(data["data"][0].is_null());
+}
+
+TEST(DataFrame, ndjson)
+{
+    std::stringstream in;
+    in << R"({"a": 1, "s": "x\ny", "j": {"k": [1, 2]}})" << "\n\n";
+    in << R"({"s": "z", "a": 2.5, "b": true})" << "\r\n";
+    in << R"({"a": 3, "s": "w"})";
+    const auto df = fromNdjson(in);
+    ASSERT_EQ(df.size(), 3);
+    EXPECT_EQ(df.columnNames(), (std::vector<std::string> { "a", "s", "j", "b" }));
+    EXPECT_EQ(df.column("a").type(), ColumnType::Double);
+    EXPECT_EQ(df.at(1).value<std::string>("s"), "z");
+    EXPECT_EQ(df.column("j").get(0), R"({"k": [1, 2]})"_json);
+    EXPECT_TRUE(df.column("b").get(0).is_null());
+    EXPECT_EQ(df.column("b").get(1), true);
+
+    std::stringstream out;
+    df.toNdjson(out);
+    std::string line;
+    std::getline(out, line);
+    EXPECT_EQ(json::parse(line), R"({"a": 1.0, "s": "x\ny", "j": {"k": [1, 2]}, "b": null})"_json);
+    const auto roundTrip = fromNdjson(out.seekg(0));
+    EXPECT_EQ(roundTrip.size(), 3);
+    EXPECT_EQ(roundTrip.at(0).value<std::string>("s"), "x\ny");
+
+    std::stringstream large;
+    for (int row = 0; row < 60000; row++) {
+        large << R"({"id": )" << row << R"(, "name": "record number )" << row << R"(")";
+        if (row >= 50000) {
+            large << R"(, "late": )" << row;
+        }
+        large << "}\n";
+    }
+    ThreadPool::setGlobalThreadCount(4);
+    const auto parsed = fromNdjson(large);
+    std::string malformed = large.str();
+    malformed.insert(malformed.find("\n", malformed.size() / 2) + 1, "{\"id\": }\n");
+    std::stringstream malformedStream(malformed);
+    EXPECT_THROW(fromNdjson(malformedStream), json::parse_error);
+    const auto errorOf = [](std::string text) {
+        std::stringstream stream(std::move(text));
+        try {
+            fromNdjson(stream);
+        } catch (const std::invalid_argument& error) {
+            return std::string(error.what());
+        }
+        return std::string();
+    };
+    std::string notRecord = large.str();
+    const size_t lastLineBreak = notRecord.rfind("\n", notRecord.size() - 2);
+    notRecord.insert(lastLineBreak + 1, "[1, 2]\n");
+    EXPECT_EQ(errorOf(notRecord), "invalid json line 60000: expected an object");
+    ThreadPool::setGlobalThreadCount(std::thread::hardware_concurrency());
+    EXPECT_EQ(errorOf("{\"a\": 1}\n\n5\n"), "invalid json line 3: expected an object");
+    EXPECT_EQ(errorOf("{\"a\": 1}\n{\"a\": 2, \"b\": 3, \"a\": [4]}"), "invalid json line 2: duplicate key a");
+    ASSERT_EQ(parsed.size(), 60000);
+    EXPECT_EQ(parsed.column("id").type(), ColumnType::Int);
+    EXPECT_EQ(parsed.at(45678).value<int>("id"), 45678);
+    EXPECT_EQ(parsed.at(45678).value<std::string>("name"), "record number 45678");
+    EXPECT_TRUE(parsed.column("late").get(49999).is_null());
+    EXPECT_EQ(parsed.column("late").get(50001), 50001);
+
+    large.clear();
+    large.seekg(0);
+    NdjsonBatchReader reader(large, 25000);
+    size_t rows = 0;
+    std::vector<size_t> batchSizes;
+    while (auto batch = reader.next()) {
+        EXPECT_EQ(batch->at(0).value<int>("id"), rows);
+        rows += batch->size();
+        batchSizes.push_back(batch->size());
+    }
+    EXPECT_EQ(batchSizes, (std::vector<size_t> { 25000, 25000, 10000 }));
+
+    std::stringstream notRecordStream(notRecord);
+    NdjsonBatchReader notRecordReader(notRecordStream, 25000);
+    EXPECT_EQ(notRecordReader.next()->size(), 25000);
+    EXPECT_EQ(notRecordReader.next()->size(), 25000);
+    try {
+        notRecordReader.next();
+        ADD_FAILURE() << "the line that is not an object was accepted";
+    } catch (const std::invalid_argument& error) {
+        // Lines are numbered from the start of the input, not of the batch.
+        EXPECT_STREQ(error.what(), "invalid json line 60000: expected an object");
+    }
+}
+
+TEST(DataFrame, arenaStringStorage)
+{
+    std::stringstream in;
+    in << "id,name\n";
+    for (int row = 0; row < 100; row++) {
+        in << row << ",\"name number " << row << "\"\n";
+    }
+    auto df = fromCsv(in);
+    ASSERT_FALSE(df.column("name").strings().isDictionary());
+    EXPECT_EQ(df.at(42).get<std::string_view>("name"), "name number 42");
+    const auto first = df.at(0).get<std::string_view>("name");
+    const auto second = df.at(1).get<std::string_view>("name");
+    EXPECT_EQ(first.data() + first.size(), second.data());
+
+    df.addRow({ { "id", 100 }, { "name", "" } });
+    df.addRow({ { "id", 101 }, { "name", "last" } });
+    EXPECT_EQ(df.at(100).get<std::string_view>("name"), "");
+    EXPECT_EQ(df.at(101).get<std::string_view>("name"), "last");
+
+    const std::vector<size_t> rows = { 101, 7, 100 };
+    const auto taken = df.take(rows);
+    EXPECT_EQ(taken.at(0).get<std::string_view>("name"), "last");
+    EXPECT_EQ(taken.at(1).get<std::string_view>("name"), "name number 7");
+    EXPECT_EQ(taken.at(2).get<std::string_view>("name"), "");
+    EXPECT_LT(taken.column("name").memoryUsage(), 256);
+
+    EXPECT_EQ(splitStringView("a,,b", ","), (std::vector<std::string_view> { "a", "", "b" }));
+    EXPECT_EQ(splitString("a,,b", ","), (std::vector<std::string> { "a", "", "b" }));
+}
+
+TEST(DataFrame, typedColumnsWithNulls)
+{
+    std::stringstream csv;
+    csv << "a,b,c\n";
+    size_t zeros = 0;
+    size_t ones = 0;
+    for (int row = 0; row < 10000; row++) {
+        zeros += row % 3 != 0 && row % 7 == 0;
+        ones += row % 3 != 0 && row % 7 == 1;
+        if (row % 3 == 0) {
+            csv << row << "\n";
+        } else {
+            csv << row << "," << row % 7 << ",s" << row % 5 << "\n";
+        }
+    }
+    const auto df = fromCsv(csv);
+    ASSERT_EQ(df.column("b").type(), ColumnType::Int);
+    ASSERT_EQ(df.column("c").type(), ColumnType::String);
+    EXPECT_TRUE(df.column("b").isNull(0));
+    EXPECT_FALSE(df.column("b").isNull(1));
+    EXPECT_EQ(df.column("b").get(0), json());
+    EXPECT_EQ(df.at(3).data(), (json { { "a", 3 }, { "b", nullptr }, { "c", nullptr } }));
+
+    // Nulls compare like json nulls: smaller than numbers and unequal to them.
+    EXPECT_EQ(df.query("b"_c < 1).size(), 3334 + zeros);
+    EXPECT_EQ(df.query("b"_c >= 0).size(), 6666);
+    EXPECT_EQ(df.query("b"_c != 2).size(), 10000 - df.query("b"_c == 2).size());
+
+    const auto byB = df.groupBy({ "b" }).agg({ { "a", Aggregation::Count }, { "b", Aggregation::Sum } });
+    ASSERT_EQ(byB.size(), 8);
+    EXPECT_EQ(byB.at(0).data()["b"], json());
+    EXPECT_EQ(byB.at(0).value<int>("a_count"), 3334);
+    const auto byA = df.groupBy({ "a" }).agg({ { "b", Aggregation::Max } });
+    EXPECT_EQ(byA.at(0).data()["b_max"], json());
+    EXPECT_EQ(byA.at(1).value<int>("b_max"), 1);
+
+    const auto sorted = df.sortBy({ "b", "a" });
+    EXPECT_EQ(sorted.at(0).value<int>("a"), 0);
+    EXPECT_EQ(sorted.at(3333).value<int>("a"), 9999);
+    EXPECT_EQ(sorted.at(3334).value<int>("b"), 0);
+    EXPECT_EQ(df.sortBy({ "b" }, false).at(9999).data()["b"], json());
+
+    DataFrame keys(std::vector<std::string> { "b", "name" });
+    keys.addRow({ { "b", 1 }, { "name", "one" } });
+    keys.addRow({ { "b", nullptr }, { "name", "null" } });
+    const auto joined = df.join(keys, { "b" }, JoinType::Left);
+    EXPECT_EQ(joined.size(), 10000);
+    EXPECT_EQ(joined.column("name").type(), ColumnType::String);
+    EXPECT_EQ(df.join(keys, { "b" }).size(), ones);
+
+    const std::string path = std::filesystem::temp_directory_path() / "dataframe_nulls_test.jdf";
+    df.toBinary(path);
+    const auto mapped = mapBinary(path);
+    ASSERT_EQ(mapped.column("b").type(), ColumnType::Int);
+    for (size_t row = 0; row < 10; row++) {
+        EXPECT_EQ(mapped.at(row).data(), df.at(row).data());
+    }
+    EXPECT_EQ(mapped.query("b"_c < 1).size(), df.query("b"_c < 1).size());
+    std::filesystem::remove(path);
+
+    std::stringstream ndjson("{\"x\": 1, \"y\": true}\n{\"x\": 2}\n{\"y\": false}\n");
+    const auto lines = fromNdjson(ndjson);
+    EXPECT_EQ(lines.column("x").type(), ColumnType::Int);
+    EXPECT_EQ(lines.column("y").type(), ColumnType::Bool);
+    EXPECT_EQ(lines.at(1).data(), (json { { "x", 2 }, { "y", nullptr } }));
+    EXPECT_EQ(lines.at(2).data(), (json { { "x", nullptr }, { "y", false } }));
+
+    // Ints that are not exact as doubles keep a mixed column exact.
+    const Column mixed(json::parse("[9007199254740993, 0.5]"));
+    EXPECT_EQ(mixed.type(), ColumnType::Json);
+    EXPECT_EQ(mixed.get(0).get<int64_t>(), 9007199254740993);
+    const Column widened(json::parse("[3, null, 0.5]"));
+    EXPECT_EQ(widened.type(), ColumnType::Double);
+    EXPECT_EQ(widened.get(1), json());
+}
@@ -1,58 +1,119 @@
 #pragma once
 #include "DataFrame.hpp"
 #include <Eigen/Core>
+#include <algorithm>
 #include <cassert>
+#include <span>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 namespace jdf {
 
+/**
+ * Reads the comma separated columns of a row into a fixed size Eigen vector.
+ */
+template <typename Vector>
+Vector rowToVector(const RowView& row, std::string_view columns)
+{
+    Vector vector;
+    Eigen::Index i = 0;
+    size_t begin = 0;
+    while (begin <= columns.size()) {
+        const size_t end = std::min(columns.find(',', begin), columns.size());
+        assert(i < Vector::SizeAtCompileTime);
+        vector[i++] = row.value<typename Vector::Scalar>(columns.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    assert(i == Vector::SizeAtCompileTime);
+    return vector;
+}
+
+template <typename Scalar, int Columns>
+auto DataFrame::toMatrix(std::string_view columns) const
+{
+    std::vector<const Column*> sources;
+    size_t begin = 0;
+    while (begin <= columns.size()) {
+        const size_t end = std::min(columns.find(',', begin), columns.size());
+        sources.push_back(&column(columns.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    assert(Columns == Eigen::Dynamic || sources.size() == static_cast<size_t>(Columns));
+
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Columns> matrix(static_cast<Eigen::Index>(size()), static_cast<Eigen::Index>(sources.size()));
+    for (size_t i = 0; i < sources.size(); i++) {
+        const Column& source = *sources[i];
+        const auto copy = [&]<typename T>(std::span<const T> values) {
+            matrix.col(i) = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(values.data(), values.size()).template cast<Scalar>();
+        };
+        // Null rows take the per-row path, which reports them like Json nulls.
+        switch (source.nulls() == nullptr ? source.type() : ColumnType::Json) {
+        case ColumnType::Int:
+            copy(source.values<int64_t>());
+            break;
+        case ColumnType::Double:
+            copy(source.values<double>());
+            break;
+        case ColumnType::Bool:
+            copy(source.values<uint8_t>());
+            break;
+        default:
+            for (size_t row = 0; row < size(); row++) {
+                matrix(row, i) = source.value<Scalar>(row);
+            }
+            break;
+        }
+    }
+    return matrix;
+}
+
+template <typename Scalar, size_t Count>
+auto DataFrame::toMatrix(const char* const (&columns)[Count]) const
+{
+    std::string joined = columns[0];
+    for (size_t i = 1; i < Count; i++) {
+        joined += ',';
+        joined += columns[i];
+    }
+    return toMatrix<Scalar, static_cast<int>(Count)>(joined);
+}
+
+template <typename T>
+auto DataFrame::columnMap(std::string_view column) const
+{
+    const auto values = this->column(column).values<T>();
+    return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(values.data(), static_cast<Eigen::Index>(values.size()));
+}
+
 template <>
 struct SeriesConverter<Eigen::Vector3f> {
-    static Eigen::Vector3f convert(const json& data, std::string_view columns)
+    static Eigen::Vector3f convert(const RowView& row, std::string_view columns)
     {
-        const auto columnSplit = splitString(std::string(columns), ",");
-        assert(columnSplit.size() == 3);
-
-        return Eigen::Vector3f(data[columnSplit[0]],
-            data[columnSplit[1]],
-            data[columnSplit[2]]);
+        return rowToVector<Eigen::Vector3f>(row, columns);
     }
 };
 
 template <>
 struct SeriesConverter<Eigen::Vector2f> {
-    static Eigen::Vector2f convert(const json& data, std::string_view columns)
+    static Eigen::Vector2f convert(const RowView& row, std::string_view columns)
     {
-        const auto columnSplit = splitString(std::string(columns), ",");
-        assert(columnSplit.size() == 2);
-
-        return Eigen::Vector2f(data[columnSplit[0]],
-            data[columnSplit[1]]);
+        return rowToVector<Eigen::Vector2f>(row, columns);
     }
 };
 
 template <>
 struct SeriesConverter<Eigen::Vector3i> {
-    static Eigen::Vector3i convert(const json& data, std::string_view columns)
+    static Eigen::Vector3i convert(const RowView& row, std::string_view columns)
     {
-        const auto columnSplit = splitString(std::string(columns), ",");
-        assert(columnSplit.size() == 3);
-
-        return Eigen::Vector3i(data[columnSplit[0]],
-            data[columnSplit[1]],
-            data[columnSplit[2]]);
+        return rowToVector<Eigen::Vector3i>(row, columns);
     }
 };
 
 template <>
 struct SeriesConverter<Eigen::Vector2i> {
-    static Eigen::Vector2i convert(const json& data, std::string_view columns)
+    static Eigen::Vector2i convert(const RowView& row, std::string_view columns)
     {
-        const auto columnSplit = splitString(std::string(columns), ",");
-        assert(columnSplit.size() == 2);
-
-        return Eigen::Vector2i(data[columnSplit[0]],
-            data[columnSplit[1]]);
+        return rowToVector<Eigen::Vector2i>(row, columns);
     }
 };
 
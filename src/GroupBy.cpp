@@ -0,0 +1,360 @@
+#include "GroupBy.hpp"
+#include "DataFrame.hpp"
+#include "ThreadPool.hpp"
+#include "ValueHash.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace jdf {
+
+namespace {
+    constexpr size_t minRowsPerPartition = 1 << 16;
+
+    std::string_view nameOf(Aggregation aggregation)
+    {
+        switch (aggregation) {
+        case Aggregation::Sum:
+            return "sum";
+        case Aggregation::Mean:
+            return "mean";
+        case Aggregation::Count:
+            return "count";
+        case Aggregation::Min:
+            return "min";
+        case Aggregation::Max:
+            return "max";
+        }
+        return "";
+    }
+
+    bool isTypedNull(const Column& column, size_t row)
+    {
+        const Bitmap* nulls = column.nulls();
+        return nulls != nullptr && nulls->test(row);
+    }
+
+    uint64_t hashValue(const Column& column, size_t row)
+    {
+        if (isTypedNull(column, row)) {
+            return hashJson(json());
+        }
+        switch (column.type()) {
+        case ColumnType::Int:
+            return std::hash<int64_t> {}(column.values<int64_t>()[row]);
+        case ColumnType::Double: {
+            const double value = column.values<double>()[row];
+            // All NaN are grouped together, whatever their payload.
+            return std::isnan(value) ? 0 : std::hash<double> {}(value);
+        }
+        case ColumnType::Bool:
+            return column.values<uint8_t>()[row];
+        case ColumnType::String: {
+            const auto& strings = column.strings();
+            return strings.isDictionary() ? strings.codes()[row] : std::hash<std::string_view> {}(strings[row]);
+        }
+        case ColumnType::Json:
+            return hashJson(column.values<json>()[row]);
+        case ColumnType::Empty:
+            break;
+        }
+        return 0;
+    }
+
+    bool equalValues(const Column& column, size_t lhs, size_t rhs)
+    {
+        // Nulls form a group of their own, like the nulls of a Json column.
+        if (column.nulls() != nullptr && (isTypedNull(column, lhs) || isTypedNull(column, rhs))) {
+            return isTypedNull(column, lhs) && isTypedNull(column, rhs);
+        }
+        switch (column.type()) {
+        case ColumnType::Int:
+            return column.values<int64_t>()[lhs] == column.values<int64_t>()[rhs];
+        case ColumnType::Double: {
+            const double lhsValue = column.values<double>()[lhs];
+            const double rhsValue = column.values<double>()[rhs];
+            return lhsValue == rhsValue || (std::isnan(lhsValue) && std::isnan(rhsValue));
+        }
+        case ColumnType::Bool:
+            return column.values<uint8_t>()[lhs] == column.values<uint8_t>()[rhs];
+        case ColumnType::String: {
+            const auto& strings = column.strings();
+            return strings.isDictionary() ? strings.codes()[lhs] == strings.codes()[rhs] : strings[lhs] == strings[rhs];
+        }
+        case ColumnType::Json:
+            return column.values<json>()[lhs] == column.values<json>()[rhs];
+        case ColumnType::Empty:
+            break;
+        }
+        return true;
+    }
+
+    /**
+     * The state of all aggregations of one column in one group. Int and Bool columns are aggregated as
+     * integers, Double columns as doubles.
+     */
+    struct Accumulator {
+        size_t count = 0;
+        int64_t intSum = 0;
+        int64_t intMin = std::numeric_limits<int64_t>::max();
+        int64_t intMax = std::numeric_limits<int64_t>::lowest();
+        double sum = 0.0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+
+        void add(int64_t value)
+        {
+            count++;
+            intSum += value;
+            intMin = std::min(intMin, value);
+            intMax = std::max(intMax, value);
+        }
+
+        void add(double value)
+        {
+            if (std::isnan(value)) {
+                return;
+            }
+            count++;
+            sum += value;
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+
+        void merge(const Accumulator& other)
+        {
+            count += other.count;
+            intSum += other.intSum;
+            intMin = std::min(intMin, other.intMin);
+            intMax = std::max(intMax, other.intMax);
+            sum += other.sum;
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+    };
+
+    void accumulate(const Column& column, size_t row, Accumulator& accumulator)
+    {
+        if (isTypedNull(column, row)) {
+            return;
+        }
+        switch (column.type()) {
+        case ColumnType::Int:
+            accumulator.add(column.values<int64_t>()[row]);
+            break;
+        case ColumnType::Double:
+            accumulator.add(column.values<double>()[row]);
+            break;
+        case ColumnType::Bool:
+            accumulator.add(static_cast<int64_t>(column.values<uint8_t>()[row]));
+            break;
+        case ColumnType::String:
+            accumulator.count++;
+            break;
+        case ColumnType::Json: {
+            const json& value = column.values<json>()[row];
+            if (value.is_number()) {
+                accumulator.add(value.get<double>());
+            } else if (!value.is_null()) {
+                accumulator.count++;
+            }
+            break;
+        }
+        case ColumnType::Empty:
+            break;
+        }
+    }
+
+    /**
+     * Sum, Mean, Min and Max of a Json column aggregate its numbers and skip nulls, any other value has
+     * no numeric meaning.
+     */
+    void checkNumeric(const Column& column, const std::string& name)
+    {
+        const auto isNumeric = [](const json& value) {
+            return value.is_number() || value.is_null();
+        };
+        if (column.type() == ColumnType::String
+            || (column.type() == ColumnType::Json && !std::all_of(column.values<json>().begin(), column.values<json>().end(), isNumeric))) {
+            throw std::invalid_argument("column " + name + " is not numeric");
+        }
+    }
+
+    Column aggregate(ColumnType type, Aggregation aggregation, const std::vector<Accumulator>& accumulators, size_t stride, size_t offset)
+    {
+        if (type == ColumnType::Empty) {
+            // A column without values only occurs in a DataFrame without rows, which has no groups.
+            assert(accumulators.empty());
+            return Column(aggregation == Aggregation::Count ? ColumnType::Int : ColumnType::Double);
+        }
+        const bool isInteger = type == ColumnType::Int || type == ColumnType::Bool;
+        const size_t groupCount = accumulators.size() / stride;
+        if (aggregation == Aggregation::Count || (isInteger && aggregation != Aggregation::Mean)) {
+            // The minimum and maximum of a group without values, i.e. only nulls, are null.
+            Column values(ColumnType::Int);
+            values.reserve(groupCount);
+            for (size_t group = 0; group < groupCount; group++) {
+                const Accumulator& accumulator = accumulators[group * stride + offset];
+                if (accumulator.count == 0 && (aggregation == Aggregation::Min || aggregation == Aggregation::Max)) {
+                    values.addNull();
+                    continue;
+                }
+                values.addInt(aggregation == Aggregation::Count ? static_cast<int64_t>(accumulator.count)
+                        : aggregation == Aggregation::Sum       ? accumulator.intSum
+                        : aggregation == Aggregation::Min       ? accumulator.intMin
+                                                                : accumulator.intMax);
+            }
+            return values;
+        }
+
+        std::vector<double> values(groupCount);
+        for (size_t group = 0; group < groupCount; group++) {
+            const Accumulator& accumulator = accumulators[group * stride + offset];
+            const double sum = isInteger ? static_cast<double>(accumulator.intSum) : accumulator.sum;
+            const bool isEmpty = accumulator.count == 0;
+            switch (aggregation) {
+            case Aggregation::Sum:
+                values[group] = sum;
+                break;
+            case Aggregation::Mean:
+                values[group] = isEmpty ? std::nan("") : sum / static_cast<double>(accumulator.count);
+                break;
+            case Aggregation::Min:
+                values[group] = isEmpty ? std::nan("") : accumulator.min;
+                break;
+            case Aggregation::Max:
+                values[group] = isEmpty ? std::nan("") : accumulator.max;
+                break;
+            case Aggregation::Count:
+                break;
+            }
+        }
+        return Column(ColumnBuffer<double>(std::move(values)));
+    }
+}
+
+GroupBy::GroupBy(const DataFrame& dataFrame, std::vector<std::string> keys)
+    : _dataFrame(&dataFrame)
+{
+    for (const auto& key : keys) {
+        const auto index = dataFrame.columnIndex(key);
+        assert(index.has_value());
+        _keys.push_back(*index);
+    }
+}
+
+DataFrame GroupBy::agg(const std::vector<std::pair<std::string, Aggregation>>& aggregations) const
+{
+    const DataFrame& dataFrame = *_dataFrame;
+    std::vector<const Column*> keys;
+    for (const size_t key : _keys) {
+        keys.push_back(&dataFrame.column(key));
+    }
+
+    for (auto it = aggregations.begin(); it != aggregations.end(); it++) {
+        if (std::find(aggregations.begin(), it, *it) != it) {
+            throw std::invalid_argument("duplicate aggregation " + it->first + "_" + std::string(nameOf(it->second)));
+        }
+    }
+
+    // Every aggregated column gets one accumulator per group, shared by all of its aggregations.
+    std::vector<size_t> valueColumns;
+    std::vector<size_t> accumulatorOffsets;
+    for (const auto& [name, aggregation] : aggregations) {
+        const auto index = dataFrame.columnIndex(name);
+        assert(index.has_value());
+        if (aggregation != Aggregation::Count) {
+            checkNumeric(dataFrame.column(*index), name);
+        }
+        const auto it = std::find(valueColumns.begin(), valueColumns.end(), *index);
+        accumulatorOffsets.push_back(it - valueColumns.begin());
+        if (it == valueColumns.end()) {
+            valueColumns.push_back(*index);
+        }
+    }
+    const size_t stride = valueColumns.size();
+
+    std::vector<uint64_t> hashes(dataFrame.size());
+    const auto hashOf = [&](size_t row) {
+        return hashes[row];
+    };
+    const auto equalKeys = [&](size_t lhs, size_t rhs) {
+        return std::all_of(keys.begin(), keys.end(), [&](const Column* key) {
+            return equalValues(*key, lhs, rhs);
+        });
+    };
+    using GroupTable = std::unordered_map<size_t, size_t, decltype(hashOf), decltype(equalKeys)>;
+
+    // A table maps the first row of every group to the index of the group.
+    struct PartialTable {
+        GroupTable groups;
+        std::vector<size_t> firstRows;
+        std::vector<Accumulator> accumulators;
+    };
+
+    ThreadPool& pool = ThreadPool::global();
+    const size_t partitionCount = std::clamp<size_t>(dataFrame.size() / minRowsPerPartition, 1, pool.threadCount());
+    std::vector<PartialTable> partials;
+    for (size_t partition = 0; partition < partitionCount; partition++) {
+        partials.push_back({ GroupTable(0, hashOf, equalKeys), {}, {} });
+    }
+    pool.run(partitionCount, [&](size_t partition) {
+        const size_t begin = dataFrame.size() * partition / partitionCount;
+        const size_t end = dataFrame.size() * (partition + 1) / partitionCount;
+        for (size_t row = begin; row < end; row++) {
+            uint64_t hash = 0;
+            for (const Column* key : keys) {
+                hash = (hash ^ hashValue(*key, row)) * 0x9e3779b97f4a7c15;
+            }
+            hashes[row] = hash;
+        }
+
+        PartialTable& table = partials[partition];
+        for (size_t row = begin; row < end; row++) {
+            const auto [it, isNew] = table.groups.try_emplace(row, table.firstRows.size());
+            if (isNew) {
+                table.firstRows.push_back(row);
+                table.accumulators.resize(table.accumulators.size() + stride);
+            }
+            Accumulator* accumulators = table.accumulators.data() + it->second * stride;
+            for (size_t value = 0; value < stride; value++) {
+                accumulate(dataFrame.column(valueColumns[value]), row, accumulators[value]);
+            }
+        }
+    });
+
+    // Merging the partitions in order keeps the groups in the order of their first row.
+    PartialTable& result = partials[0];
+    for (size_t partition = 1; partition < partitionCount; partition++) {
+        const PartialTable& partial = partials[partition];
+        for (size_t group = 0; group < partial.firstRows.size(); group++) {
+            const auto [it, isNew] = result.groups.try_emplace(partial.firstRows[group], result.firstRows.size());
+            if (isNew) {
+                result.firstRows.push_back(partial.firstRows[group]);
+                result.accumulators.resize(result.accumulators.size() + stride);
+            }
+            for (size_t value = 0; value < stride; value++) {
+                result.accumulators[it->second * stride + value].merge(partial.accumulators[group * stride + value]);
+            }
+        }
+    }
+
+    std::vector<std::string> columnNames;
+    std::vector<Column> columns;
+    for (const size_t key : _keys) {
+        columnNames.push_back(dataFrame.columnNames()[key]);
+        columns.push_back(dataFrame.column(key).take(result.firstRows));
+    }
+    for (size_t i = 0; i < aggregations.size(); i++) {
+        const auto& [name, aggregation] = aggregations[i];
+        columnNames.push_back(name + "_" + std::string(nameOf(aggregation)));
+        const ColumnType type = dataFrame.column(valueColumns[accumulatorOffsets[i]]).type();
+        columns.push_back(aggregate(type, aggregation, result.accumulators, stride, accumulatorOffsets[i]));
+    }
+    return DataFrame(std::move(columnNames), std::move(columns));
+}
+
+}
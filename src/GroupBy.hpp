@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jdf {
+
+class DataFrame;
+
+enum class Aggregation {
+    Sum,
+    Mean,
+    Count,
+    Min,
+    Max,
+};
+
+/**
+ * The rows of a DataFrame grouped by the values of one or more key columns, see DataFrame::groupBy.
+ * The DataFrame has to outlive the GroupBy.
+ */
+class GroupBy {
+public:
+    GroupBy(const DataFrame& dataFrame, std::vector<std::string> keys);
+
+    /**
+     * Aggregates the given columns of every group. Returns a DataFrame with one row per group, in the
+     * order of their first row, with the key columns followed by one column per aggregation, named
+     * "<column>_<aggregation>", e.g. "price_sum".
+     * Sum, Mean, Min and Max require Int, Double or Bool columns, or Json columns of numbers, and ignore
+     * NaN and null. The numbers of a Json column are aggregated as doubles. Count counts the values that
+     * are neither NaN nor null. Min and Max of a group without values are null for Int and Bool columns
+     * and NaN otherwise.
+     * Large DataFrames are aggregated in parallel into partial tables per thread, which are merged at the
+     * end.
+     * @throws std::invalid_argument if the same aggregation of a column is requested twice, or if Sum,
+     * Mean, Min or Max is requested for a column with values other than numbers and null.
+     */
+    DataFrame agg(const std::vector<std::pair<std::string, Aggregation>>& aggregations) const;
+
+private:
+    const DataFrame* _dataFrame;
+    std::vector<size_t> _keys;
+};
+
+}
@@ -0,0 +1,153 @@
+#include "HashIndex.hpp"
+#include <cmath>
+#include <limits>
+
+namespace jdf {
+
+namespace {
+    template <typename Map, typename Key>
+    std::span<const size_t> rowsOf(const Map& map, const Key& key)
+    {
+        const auto it = map.find(key);
+        if (it == map.end()) {
+            return {};
+        }
+        return it->second;
+    }
+}
+
+HashIndex::HashIndex(const Column& column)
+{
+    update(column);
+}
+
+void HashIndex::update(const Column& column)
+{
+    if (column.type() != _type) {
+        _type = column.type();
+        _rowCount = 0;
+        _ints.clear();
+        _doubles.clear();
+        _strings.clear();
+        _values.clear();
+    }
+
+    const size_t begin = _rowCount;
+    _rowCount = column.size();
+    // Null rows of typed columns are not indexed, a null literal is never looked up in them.
+    const Bitmap* nulls = column.nulls();
+    const auto isNull = [&](size_t row) {
+        return nulls != nullptr && nulls->test(row);
+    };
+    switch (_type) {
+    case ColumnType::Empty:
+        break;
+    case ColumnType::Int: {
+        const auto values = column.values<int64_t>();
+        for (size_t row = begin; row < values.size(); row++) {
+            if (!isNull(row)) {
+                _ints[values[row]].push_back(row);
+            }
+        }
+        break;
+    }
+    case ColumnType::Double: {
+        const auto values = column.values<double>();
+        for (size_t row = begin; row < values.size(); row++) {
+            // NaN is not equal to anything, not even itself.
+            if (!std::isnan(values[row]) && !isNull(row)) {
+                _doubles[values[row]].push_back(row);
+            }
+        }
+        break;
+    }
+    case ColumnType::Bool: {
+        const auto values = column.values<uint8_t>();
+        for (size_t row = begin; row < values.size(); row++) {
+            if (!isNull(row)) {
+                _ints[values[row]].push_back(row);
+            }
+        }
+        break;
+    }
+    case ColumnType::String:
+        for (size_t row = begin; row < column.size(); row++) {
+            if (isNull(row)) {
+                continue;
+            }
+            const auto value = column.string(row);
+            auto it = _strings.find(value);
+            if (it == _strings.end()) {
+                it = _strings.emplace(value, std::vector<size_t> {}).first;
+            }
+            it->second.push_back(row);
+        }
+        break;
+    case ColumnType::Json: {
+        const auto values = column.values<json>();
+        for (size_t row = begin; row < values.size(); row++) {
+            if (!(values[row].is_number_float() && std::isnan(values[row].get<double>()))) {
+                _values[values[row]].push_back(row);
+            }
+        }
+        break;
+    }
+    }
+}
+
+std::optional<std::span<const size_t>> HashIndex::find(const json& value) const
+{
+    switch (_type) {
+    case ColumnType::Int:
+        // Other numbers are compared as doubles, which is left to the scan.
+        if (value.is_number_integer() && !(value.is_number_unsigned() && value.get<uint64_t>() > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))) {
+            return rowsOf(_ints, value.get<int64_t>());
+        }
+        break;
+    case ColumnType::Double:
+        if (value.is_number()) {
+            return rowsOf(_doubles, value.get<double>());
+        }
+        break;
+    case ColumnType::Bool:
+        if (value.is_boolean()) {
+            return rowsOf(_ints, int64_t { value.get<bool>() });
+        }
+        break;
+    case ColumnType::String:
+        if (value.is_string()) {
+            return rowsOf(_strings, std::string_view(value.get_ref<const std::string&>()));
+        }
+        break;
+    case ColumnType::Json:
+        if (value.is_number_float() && std::isnan(value.get<double>())) {
+            return std::span<const size_t> {};
+        }
+        return rowsOf(_values, value);
+    case ColumnType::Empty:
+        break;
+    }
+    return std::nullopt;
+}
+
+size_t HashIndex::memoryUsage() const
+{
+    size_t size = memory::hashMapSize(_ints) + memory::hashMapSize(_doubles) + memory::hashMapSize(_strings);
+    const auto addRows = [&](const auto& map) {
+        for (const auto& [value, rows] : map) {
+            size += memory::vectorSize(rows);
+        }
+    };
+    addRows(_ints);
+    addRows(_doubles);
+    addRows(_strings);
+    for (const auto& [value, rows] : _strings) {
+        size += memory::stringSize(value);
+    }
+    for (const auto& [value, rows] : _values) {
+        size += memory::mapNodeSize<decltype(_values)>() + memory::jsonSize(value) + memory::vectorSize(rows);
+    }
+    return size;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Column.hpp"
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * Maps the values of a column to the rows containing them, in ascending order.
+ * The index is kept up to date by calling update() after rows have been appended to the column. When the
+ * type of the column changes the index is rebuilt.
+ */
+class HashIndex {
+public:
+    explicit HashIndex(const Column& column);
+
+    /**
+     * Indexes the rows that have been appended to column since the last update.
+     */
+    void update(const Column& column);
+
+    /**
+     * Returns the rows whose value equals value, with the same semantics as an Equal comparison in a
+     * query, or std::nullopt if the index cannot answer the lookup and the column has to be scanned.
+     */
+    std::optional<std::span<const size_t>> find(const json& value) const;
+    size_t memoryUsage() const;
+
+private:
+    ColumnType _type = ColumnType::Empty;
+    size_t _rowCount = 0;
+    std::unordered_map<int64_t, std::vector<size_t>> _ints;
+    std::unordered_map<double, std::vector<size_t>> _doubles;
+    std::unordered_map<std::string, std::vector<size_t>, StringHash, std::equal_to<>> _strings;
+    std::map<json, std::vector<size_t>> _values;
+};
+
+}
@@ -0,0 +1,244 @@
+#include "Join.hpp"
+#include "DataFrame.hpp"
+#include "ThreadPool.hpp"
+#include "ValueHash.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace jdf {
+
+namespace {
+    constexpr size_t noRow = std::numeric_limits<size_t>::max();
+    constexpr size_t rowsPerBatch = 1 << 16;
+
+    uint64_t hashValue(const Column& column, size_t row)
+    {
+        switch (column.type()) {
+        case ColumnType::Int:
+            return std::hash<int64_t> {}(column.values<int64_t>()[row]);
+        case ColumnType::Double:
+            return hashDouble(column.values<double>()[row]);
+        case ColumnType::Bool:
+            return column.values<uint8_t>()[row];
+        case ColumnType::String:
+            return std::hash<std::string_view> {}(column.string(row));
+        case ColumnType::Json:
+            return hashJson(column.values<json>()[row]);
+        case ColumnType::Empty:
+            break;
+        }
+        return 0;
+    }
+
+    bool equalValues(const Column& lhs, size_t lhsRow, const Column& rhs, size_t rhsRow)
+    {
+        // Null keys never match, whatever the type of their column.
+        if ((lhs.nulls() != nullptr && lhs.nulls()->test(lhsRow)) || (rhs.nulls() != nullptr && rhs.nulls()->test(rhsRow))) {
+            return false;
+        }
+        if (lhs.type() == rhs.type()) {
+            switch (lhs.type()) {
+            case ColumnType::Int:
+                return lhs.values<int64_t>()[lhsRow] == rhs.values<int64_t>()[rhsRow];
+            case ColumnType::Double:
+                return lhs.values<double>()[lhsRow] == rhs.values<double>()[rhsRow];
+            case ColumnType::Bool:
+                return lhs.values<uint8_t>()[lhsRow] == rhs.values<uint8_t>()[rhsRow];
+            case ColumnType::String:
+                return lhs.string(lhsRow) == rhs.string(rhsRow);
+            default:
+                break;
+            }
+        }
+        const json lhsValue = lhs.get(lhsRow);
+        return !lhsValue.is_null() && lhsValue == rhs.get(rhsRow);
+    }
+
+    std::vector<uint64_t> hashRows(const std::vector<const Column*>& keys, size_t rowCount)
+    {
+        std::vector<uint64_t> hashes(rowCount);
+        ThreadPool::global().run((rowCount + rowsPerBatch - 1) / rowsPerBatch, [&](size_t batch) {
+            const size_t end = std::min(rowCount, (batch + 1) * rowsPerBatch);
+            for (size_t row = batch * rowsPerBatch; row < end; row++) {
+                uint64_t hash = 0;
+                for (const Column* key : keys) {
+                    hash = (hash ^ hashValue(*key, row)) * 0x9e3779b97f4a7c15;
+                }
+                hashes[row] = hash;
+            }
+        });
+        return hashes;
+    }
+
+    /**
+     * A chained hash table over the rows of the build side. The chain of every bucket lists its rows in
+     * ascending order.
+     */
+    class JoinTable {
+    public:
+        JoinTable(std::vector<const Column*> keys)
+            : _keys(std::move(keys))
+            , _hashes(hashRows(_keys, _keys.empty() ? 0 : _keys[0]->size()))
+            , _heads(std::bit_ceil(std::max<size_t>(2 * _hashes.size(), 1)), noRow)
+            , _next(_hashes.size(), noRow)
+        {
+            for (size_t row = _hashes.size(); row-- > 0;) {
+                size_t& head = _heads[_hashes[row] & (_heads.size() - 1)];
+                _next[row] = head;
+                head = row;
+            }
+        }
+
+        /**
+         * Calls found(row) for every row of the build side whose keys equal the keys of row of probeKeys.
+         */
+        template <typename Found>
+        void probe(const std::vector<const Column*>& probeKeys, size_t probeRow, uint64_t hash, Found found) const
+        {
+            for (size_t row = _heads[hash & (_heads.size() - 1)]; row != noRow; row = _next[row]) {
+                if (_hashes[row] != hash) {
+                    continue;
+                }
+                bool isEqual = true;
+                for (size_t key = 0; key < _keys.size() && isEqual; key++) {
+                    isEqual = equalValues(*probeKeys[key], probeRow, *_keys[key], row);
+                }
+                if (isEqual) {
+                    found(row);
+                }
+            }
+        }
+
+    private:
+        std::vector<const Column*> _keys;
+        std::vector<uint64_t> _hashes;
+        std::vector<size_t> _heads;
+        std::vector<size_t> _next;
+    };
+
+    std::vector<const Column*> keyColumns(const DataFrame& dataFrame, const std::vector<std::string>& on)
+    {
+        std::vector<const Column*> keys;
+        for (const auto& name : on) {
+            const auto index = dataFrame.columnIndex(name);
+            assert(index.has_value());
+            keys.push_back(&dataFrame.column(*index));
+        }
+        return keys;
+    }
+
+    /**
+     * Returns the matching pairs of rows of the probe and build side, ordered by probe row. Unmatched
+     * probe rows are paired with noRow if keepUnmatched is set.
+     */
+    std::pair<std::vector<size_t>, std::vector<size_t>> probeAll(const JoinTable& table, const std::vector<const Column*>& probeKeys, size_t probeSize, bool keepUnmatched)
+    {
+        const std::vector<uint64_t> hashes = hashRows(probeKeys, probeSize);
+        const size_t batchCount = (probeSize + rowsPerBatch - 1) / rowsPerBatch;
+        std::vector<std::vector<size_t>> probeRows(batchCount);
+        std::vector<std::vector<size_t>> buildRows(batchCount);
+        ThreadPool::global().run(batchCount, [&](size_t batch) {
+            const size_t end = std::min(probeSize, (batch + 1) * rowsPerBatch);
+            for (size_t row = batch * rowsPerBatch; row < end; row++) {
+                const size_t matchCount = buildRows[batch].size();
+                table.probe(probeKeys, row, hashes[row], [&](size_t buildRow) {
+                    probeRows[batch].push_back(row);
+                    buildRows[batch].push_back(buildRow);
+                });
+                if (keepUnmatched && buildRows[batch].size() == matchCount) {
+                    probeRows[batch].push_back(row);
+                    buildRows[batch].push_back(noRow);
+                }
+            }
+        });
+
+        std::pair<std::vector<size_t>, std::vector<size_t>> pairs;
+        for (size_t batch = 0; batch < batchCount; batch++) {
+            pairs.first.insert(pairs.first.end(), probeRows[batch].begin(), probeRows[batch].end());
+            pairs.second.insert(pairs.second.end(), buildRows[batch].begin(), buildRows[batch].end());
+        }
+        return pairs;
+    }
+
+    /**
+     * Returns the rows of column, or null for noRow.
+     */
+    Column takeOrNull(const Column& column, std::span<const size_t> rows)
+    {
+        if (std::find(rows.begin(), rows.end(), noRow) == rows.end()) {
+            return column.take(rows);
+        }
+        Column values(column.type());
+        values.reserve(rows.size());
+        for (const size_t row : rows) {
+            if (row == noRow) {
+                values.addNull();
+            } else {
+                values.push_back(column.get(row));
+            }
+        }
+        return values;
+    }
+}
+
+DataFrame hashJoin(const DataFrame& left, const DataFrame& right, const std::vector<std::string>& on, JoinType how)
+{
+    const auto leftKeys = keyColumns(left, on);
+    const auto rightKeys = keyColumns(right, on);
+    const bool keepUnmatched = how == JoinType::Left;
+
+    std::vector<size_t> leftRows;
+    std::vector<size_t> rightRows;
+    if (right.size() <= left.size()) {
+        std::tie(leftRows, rightRows) = probeAll(JoinTable(rightKeys), leftKeys, left.size(), keepUnmatched);
+    } else {
+        // Probing with the rows of right yields the pairs ordered by right, a counting sort by left row
+        // restores the order of left while keeping the pairs of a left row ordered by right.
+        const auto [probeRows, buildRows] = probeAll(JoinTable(leftKeys), rightKeys, right.size(), false);
+        std::vector<size_t> offsets(left.size() + 1, 0);
+        for (const size_t row : buildRows) {
+            offsets[row + 1]++;
+        }
+        for (size_t row = 0; row < left.size(); row++) {
+            const size_t matchCount = offsets[row + 1];
+            offsets[row + 1] = offsets[row] + (keepUnmatched ? std::max<size_t>(matchCount, 1) : matchCount);
+        }
+        leftRows.resize(offsets.back());
+        rightRows.assign(offsets.back(), noRow);
+        for (size_t row = 0; row < left.size(); row++) {
+            if (offsets[row + 1] - offsets[row] == 1) {
+                leftRows[offsets[row]] = row;
+            }
+        }
+        for (size_t pair = 0; pair < buildRows.size(); pair++) {
+            const size_t position = offsets[buildRows[pair]]++;
+            leftRows[position] = buildRows[pair];
+            rightRows[position] = probeRows[pair];
+        }
+    }
+
+    std::vector<std::string> columnNames = left.columnNames();
+    std::vector<const Column*> sources;
+    for (size_t column = 0; column < left.columnCount(); column++) {
+        sources.push_back(&left.column(column));
+    }
+    const size_t leftColumnCount = sources.size();
+    for (size_t column = 0; column < right.columnCount(); column++) {
+        const std::string& name = right.columnNames()[column];
+        if (std::find(on.begin(), on.end(), name) == on.end()) {
+            columnNames.push_back(left.columnIndex(name).has_value() ? name + "_right" : name);
+            sources.push_back(&right.column(column));
+        }
+    }
+
+    std::vector<Column> columns(sources.size());
+    ThreadPool::global().run(sources.size(), [&](size_t column) {
+        columns[column] = column < leftColumnCount ? sources[column]->take(leftRows) : takeOrNull(*sources[column], rightRows);
+    });
+    return DataFrame(std::move(columnNames), std::move(columns));
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace jdf {
+
+class DataFrame;
+
+enum class JoinType {
+    /**
+     * Only rows with a matching row in the other DataFrame.
+     */
+    Inner,
+    /**
+     * All rows of the left DataFrame, with null values for the columns of the right DataFrame if there is
+     * no matching row.
+     */
+    Left,
+};
+
+/**
+ * Joins two DataFrames on the values of the columns named on, which both DataFrames must have. Values are
+ * compared like in queries, e.g. an Int 1 matches a Double 1.0, and NaN or null never match.
+ * The result has the columns of left followed by the columns of right that are not join keys, the latter
+ * suffixed with "_right" if left has a column of the same name. It has one row per pair of matching rows,
+ * ordered by the row in left and then by the row in right.
+ * A hash table is built on the smaller DataFrame and probed with the rows of the larger one in parallel.
+ */
+DataFrame hashJoin(const DataFrame& left, const DataFrame& right, const std::vector<std::string>& on, JoinType how);
+
+}
@@ -0,0 +1,607 @@
+#include "JsonReader.hpp"
+#include "DataFrame.hpp"
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace jdf::jsonformat {
+
+namespace {
+    constexpr size_t minimumChunkSize = 1 << 20;
+
+    /**
+     * Handles the SAX events of values: scalars are appended to the column returned by cell(), nested
+     * arrays and objects are built as json values first. Subclasses handle the structure of the document
+     * around the cells.
+     */
+    class CellHandler : public nlohmann::json_sax<json> {
+    public:
+        bool null() override
+        {
+            return add(json());
+        }
+        bool boolean(bool value) override
+        {
+            return add(value);
+        }
+        bool number_integer(number_integer_t value) override
+        {
+            return add(static_cast<int64_t>(value));
+        }
+        bool number_unsigned(number_unsigned_t value) override
+        {
+            if (value <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                return add(static_cast<int64_t>(value));
+            }
+            return add(json(value));
+        }
+        bool number_float(number_float_t value, const string_t&) override
+        {
+            return add(static_cast<double>(value));
+        }
+        bool string(string_t& value) override
+        {
+            return add(std::move(value));
+        }
+        bool binary(binary_t& value) override
+        {
+            return add(json::binary(std::move(value)));
+        }
+
+        bool parse_error(size_t, const std::string&, const nlohmann::detail::exception& exception) override
+        {
+            if (const auto* error = dynamic_cast<const json::parse_error*>(&exception)) {
+                throw *error;
+            }
+            if (const auto* error = dynamic_cast<const json::out_of_range*>(&exception)) {
+                throw *error;
+            }
+            return false;
+        }
+
+    protected:
+        /**
+         * Returns the column that receives the next value outside of nested values.
+         */
+        virtual Column& cell() = 0;
+
+        bool isNested() const
+        {
+            return !_nested.empty();
+        }
+
+        void beginNested(json container)
+        {
+            _nested.push_back(std::move(container));
+        }
+
+        void nestedKey(string_t& key)
+        {
+            _nestedKeys.push_back(std::move(key));
+        }
+
+        bool endNested()
+        {
+            json value = std::move(_nested.back());
+            _nested.pop_back();
+            return add(std::move(value));
+        }
+
+    private:
+        template <typename T>
+        bool add(T&& value)
+        {
+            if (!_nested.empty()) {
+                addNested(json(std::forward<T>(value)));
+                return true;
+            }
+            using Value = std::decay_t<T>;
+            Column& column = cell();
+            if constexpr (std::is_same_v<Value, int64_t>) {
+                column.addInt(value);
+            } else if constexpr (std::is_same_v<Value, double>) {
+                column.addDouble(value);
+            } else if constexpr (std::is_same_v<Value, bool>) {
+                column.addBool(value);
+            } else if constexpr (std::is_same_v<Value, std::string>) {
+                column.addString(value);
+            } else {
+                column.push_back(json(std::forward<T>(value)));
+            }
+            return true;
+        }
+
+        void addNested(json value)
+        {
+            json& parent = _nested.back();
+            if (parent.is_object()) {
+                parent[std::move(_nestedKeys.back())] = std::move(value);
+                _nestedKeys.pop_back();
+            } else {
+                parent.push_back(std::move(value));
+            }
+        }
+
+        std::vector<json> _nested;
+        std::vector<std::string> _nestedKeys;
+    };
+
+    [[noreturn]] void invalidDocument(const std::string& message)
+    {
+        throw std::invalid_argument("invalid DataFrame json: " + message);
+    }
+
+    /**
+     * Builds the columns of a DataFrame from a document that is either
+     * - an array of column names,
+     * - an object with an array of values per column, or
+     * - an object with the column names in "columns" and an array of rows in "data".
+     * As the keys of an object may come in any order, the rows of "data" are read into positional columns
+     * and "columns" into a String column until the end of the document decides between the column and the
+     * split format. A "data" array that contains anything else than rows is read as an ordinary column.
+     */
+    class ColumnBuilder : public CellHandler {
+    public:
+        bool start_object(size_t) override
+        {
+            if (isNested() || isInCells()) {
+                beginNested(json::object());
+                return true;
+            }
+            if (_state == State::Rows) {
+                rowsToValues();
+                beginNested(json::object());
+                return true;
+            }
+            if (_state != State::Document) {
+                invalidDocument("expected an array of values");
+            }
+            _state = State::Object;
+            return true;
+        }
+
+        bool key(string_t& key) override
+        {
+            if (isNested()) {
+                nestedKey(key);
+            } else {
+                _key = std::move(key);
+            }
+            return true;
+        }
+
+        bool end_object() override
+        {
+            if (isNested()) {
+                return endNested();
+            }
+            _state = State::Done;
+            return true;
+        }
+
+        bool start_array(size_t) override
+        {
+            if (isNested() || isInCells()) {
+                beginNested(json::array());
+                return true;
+            }
+            switch (_state) {
+            case State::Document:
+                _state = State::Names;
+                break;
+            case State::Object:
+                if (hasColumn(_key) || (_key == "data" && _hasRows)) {
+                    invalidDocument("duplicate key " + _key);
+                }
+                if (_key == "data") {
+                    _state = State::Rows;
+                    _hasRows = true;
+                } else {
+                    _state = State::Values;
+                    _namedColumns.emplace_back(std::move(_key), Column());
+                }
+                break;
+            case State::Rows:
+                _state = State::Row;
+                _position = 0;
+                break;
+            default:
+                invalidDocument("column names must not be nested");
+            }
+            return true;
+        }
+
+        bool end_array() override
+        {
+            if (isNested()) {
+                return endNested();
+            }
+            switch (_state) {
+            case State::Names:
+                _state = State::Done;
+                break;
+            case State::Values:
+            case State::Rows:
+                _state = State::Object;
+                break;
+            case State::Row:
+                endRow();
+                _state = State::Rows;
+                break;
+            default:
+                invalidDocument("unexpected end of array");
+            }
+            return true;
+        }
+
+        DataFrame build()
+        {
+            if (_namedColumns.empty() && !_hasRows) {
+                return DataFrame(namesOf(_names), std::vector<Column>(_names.size()));
+            }
+
+            const auto names = std::find_if(_namedColumns.begin(), _namedColumns.end(), [](const auto& column) { return column.first == "columns"; });
+            if (_hasRows && names != _namedColumns.end()) {
+                std::vector<std::string> columnNames = namesOf(names->second);
+                if (!_rowLengths.empty() || (_rowCount > 0 && _rowColumns.size() != columnNames.size())) {
+                    invalidDocument("every row in data must have one value per column");
+                }
+                _rowColumns.resize(columnNames.size());
+                return DataFrame(std::move(columnNames), std::move(_rowColumns));
+            }
+            if (hasColumn("columns") && hasColumn("data")) {
+                invalidDocument("data must be an array of rows");
+            }
+
+            if (_hasRows) {
+                // A column named data whose values are arrays.
+                rowsToValues();
+                _state = State::Done;
+            }
+            std::stable_sort(_namedColumns.begin(), _namedColumns.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+            std::vector<std::string> columnNames;
+            std::vector<Column> columns;
+            const size_t rowCount = _namedColumns.front().second.size();
+            for (auto& [name, column] : _namedColumns) {
+                if (column.size() != rowCount) {
+                    invalidDocument("all columns must have the same number of values");
+                }
+                columnNames.push_back(std::move(name));
+                columns.push_back(std::move(column));
+            }
+            return DataFrame(std::move(columnNames), std::move(columns));
+        }
+
+    protected:
+        Column& cell() override
+        {
+            switch (_state) {
+            case State::Names:
+                return _names;
+            case State::Values:
+                return _namedColumns.back().second;
+            case State::Rows:
+                // A value in data that is not a row.
+                rowsToValues();
+                return _namedColumns.back().second;
+            case State::Row:
+                if (_position == _rowColumns.size()) {
+                    if (_rowCount > 0 && _rowLengths.empty()) {
+                        _rowLengths.assign(_rowCount, _rowColumns.size());
+                    }
+                    _rowColumns.emplace_back();
+                }
+                return _rowColumns[_position++];
+            default:
+                invalidDocument("values must be in an array");
+            }
+        }
+
+    private:
+        enum class State {
+            Document,
+            Names,
+            Object,
+            Values,
+            Rows,
+            Row,
+            Done,
+        };
+
+        bool isInCells() const
+        {
+            return _state == State::Values || _state == State::Row;
+        }
+
+        bool hasColumn(std::string_view name) const
+        {
+            return std::any_of(_namedColumns.begin(), _namedColumns.end(), [&](const auto& column) { return column.first == name; });
+        }
+
+        /**
+         * Rows of different lengths are valid in the column format, where data is an ordinary column of
+         * arrays. The length of every row is only recorded once a row deviates from the ones before it.
+         */
+        void endRow()
+        {
+            if (_position != _rowColumns.size() && _rowLengths.empty()) {
+                _rowLengths.assign(_rowCount, _rowColumns.size());
+            }
+            if (!_rowLengths.empty()) {
+                _rowLengths.push_back(_position);
+            }
+            _rowCount++;
+        }
+
+        /**
+         * Turns the rows read so far into a column named data with one array per row, which receives the
+         * remaining values of data.
+         */
+        void rowsToValues()
+        {
+            Column data;
+            data.reserve(_rowCount);
+            std::vector<size_t> next(_rowColumns.size(), 0);
+            for (size_t row = 0; row < _rowCount; row++) {
+                const size_t length = _rowLengths.empty() ? _rowColumns.size() : _rowLengths[row];
+                json values = json::array();
+                for (size_t position = 0; position < length; position++) {
+                    values.push_back(_rowColumns[position].get(next[position]++));
+                }
+                data.push_back(std::move(values));
+            }
+            _rowColumns.clear();
+            _rowLengths.clear();
+            _rowCount = 0;
+            _hasRows = false;
+            _namedColumns.emplace_back("data", std::move(data));
+            _state = State::Values;
+        }
+
+        static std::vector<std::string> namesOf(const Column& column)
+        {
+            std::vector<std::string> names;
+            for (size_t row = 0; row < column.size(); row++) {
+                names.push_back(column.value<std::string>(row));
+            }
+            return names;
+        }
+
+        State _state = State::Document;
+        Column _names;
+        std::string _key;
+        std::vector<std::pair<std::string, Column>> _namedColumns;
+        std::vector<Column> _rowColumns;
+        std::vector<size_t> _rowLengths;
+        size_t _position = 0;
+        size_t _rowCount = 0;
+        bool _hasRows = false;
+    };
+
+    /**
+     * A line of json lines that is valid json but not a record, thrown by RecordBuilder with the index of
+     * the line within its chunk.
+     */
+    struct InvalidLine {
+        size_t line;
+        std::string message;
+    };
+
+    /**
+     * Builds columns from json lines, one object per line. Columns are created in the order their keys
+     * first appear, rows without a key get null in its column.
+     */
+    class RecordBuilder : public CellHandler {
+    public:
+        bool start_object(size_t) override
+        {
+            if (isNested() || _isInRecord) {
+                beginNested(json::object());
+                return true;
+            }
+            _isInRecord = true;
+            _position = 0;
+            return true;
+        }
+
+        bool key(string_t& key) override
+        {
+            if (isNested()) {
+                nestedKey(key);
+                return true;
+            }
+            // Records usually have the same keys in the same order, so the column at the same position of
+            // the previous record is tried before looking up the key.
+            if (_position == _order.size()) {
+                _order.push_back(0);
+            }
+            if (_order[_position] >= _names.size() || _names[_order[_position]] != key) {
+                _order[_position] = columnFor(key);
+            }
+            _column = _order[_position++];
+            return true;
+        }
+
+        bool end_object() override
+        {
+            if (isNested()) {
+                return endNested();
+            }
+            _isInRecord = false;
+            _rowCount++;
+            for (auto& column : _columns) {
+                if (column.size() < _rowCount) {
+                    column.push_back(json());
+                }
+            }
+            return true;
+        }
+
+        bool start_array(size_t) override
+        {
+            if (!_isInRecord) {
+                throw InvalidLine { _line, "expected an object" };
+            }
+            beginNested(json::array());
+            return true;
+        }
+
+        bool end_array() override
+        {
+            return endNested();
+        }
+
+        /**
+         * Parses the records of all non-empty lines of text.
+         * @throws InvalidLine if a line is not an object or has a key twice.
+         */
+        void parse(std::string_view text)
+        {
+            for (_line = 0; !text.empty(); _line++) {
+                const size_t end = std::min(text.find('\n'), text.size());
+                const auto line = text.substr(0, end);
+                if (line.find_first_not_of(" \t\r") != std::string_view::npos && !json::sax_parse(line, this)) {
+                    throw InvalidLine { _line, "parsing stopped early" };
+                }
+                text.remove_prefix(std::min(end + 1, text.size()));
+            }
+        }
+
+        size_t rowCount() const
+        {
+            return _rowCount;
+        }
+
+        std::vector<std::string>& names()
+        {
+            return _names;
+        }
+
+        std::vector<Column>& columns()
+        {
+            return _columns;
+        }
+
+    protected:
+        Column& cell() override
+        {
+            if (!_isInRecord) {
+                throw InvalidLine { _line, "expected an object" };
+            }
+            // A duplicate key within a record would misalign the rows of its column.
+            if (_columns[_column].size() != _rowCount) {
+                throw InvalidLine { _line, "duplicate key " + _names[_column] };
+            }
+            return _columns[_column];
+        }
+
+    private:
+        size_t columnFor(std::string_view key)
+        {
+            const auto it = _indices.find(key);
+            if (it != _indices.end()) {
+                return it->second;
+            }
+            _names.emplace_back(key);
+            _indices.emplace(_names.back(), _names.size() - 1);
+            auto& column = _columns.emplace_back();
+            for (size_t row = 0; row < _rowCount; row++) {
+                column.push_back(json());
+            }
+            return _names.size() - 1;
+        }
+
+        std::vector<std::string> _names;
+        std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> _indices;
+        std::vector<Column> _columns;
+        std::vector<size_t> _order;
+        size_t _position = 0;
+        size_t _column = 0;
+        size_t _rowCount = 0;
+        size_t _line = 0;
+        bool _isInRecord = false;
+    };
+}
+
+DataFrame parse(std::string_view text)
+{
+    ColumnBuilder builder;
+    if (!json::sax_parse(text, &builder)) {
+        invalidDocument("parsing stopped early");
+    }
+    return builder.build();
+}
+
+DataFrame parseLines(std::string_view text, size_t firstLine)
+{
+    ProfileScope profile("fromNdjson");
+    profile.stage("parse");
+    profile.bytes(text.size(), 0);
+
+    // Line breaks cannot occur inside json strings, so every line break is a record boundary.
+    ThreadPool& pool = ThreadPool::global();
+    const size_t chunkCount = std::clamp<size_t>(text.size() / minimumChunkSize, 1, pool.threadCount() * 4);
+    const size_t rawChunkSize = text.size() / chunkCount;
+    std::vector<size_t> boundaries(chunkCount + 1, text.size());
+    boundaries[0] = 0;
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        const size_t lineBreak = text.find('\n', std::max(boundaries[chunk - 1], chunk * rawChunkSize));
+        boundaries[chunk] = lineBreak == std::string_view::npos ? text.size() : lineBreak + 1;
+    }
+    std::vector<RecordBuilder> chunks(chunkCount);
+    pool.run(chunkCount, [&](size_t chunk) {
+        try {
+            chunks[chunk].parse(text.substr(boundaries[chunk], boundaries[chunk + 1] - boundaries[chunk]));
+        } catch (const InvalidLine& error) {
+            // Lines are only counted on error, the chunks don't know their first line otherwise.
+            const size_t line = firstLine + std::count(text.begin(), text.begin() + boundaries[chunk], '\n') + error.line;
+            throw std::invalid_argument("invalid json line " + std::to_string(line) + ": " + error.message);
+        }
+    });
+    if (chunkCount == 1) {
+        DataFrame dataFrame(std::move(chunks[0].names()), std::move(chunks[0].columns()));
+        profile.rows(dataFrame.size(), dataFrame.size());
+        return dataFrame;
+    }
+
+    // The columns are the union of the columns of all chunks, in the order they first appear.
+    profile.stage("merge");
+    std::vector<std::string> columnNames;
+    std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> indices;
+    for (auto& chunk : chunks) {
+        for (const auto& name : chunk.names()) {
+            if (indices.emplace(name, columnNames.size()).second) {
+                columnNames.push_back(name);
+            }
+        }
+    }
+    std::vector<Column> columns(columnNames.size());
+    pool.run(columns.size(), [&](size_t column) {
+        for (auto& chunk : chunks) {
+            const auto& names = chunk.names();
+            const auto it = std::find(names.begin(), names.end(), columnNames[column]);
+            if (it == names.end()) {
+                for (size_t row = 0; row < chunk.rowCount(); row++) {
+                    columns[column].push_back(json());
+                }
+                continue;
+            }
+            Column& values = chunk.columns()[it - names.begin()];
+            if (columns[column].size() == 0 && columns[column].type() == ColumnType::Empty) {
+                columns[column] = std::move(values);
+            } else {
+                columns[column].append(values);
+                values = Column();
+            }
+        }
+    });
+    DataFrame dataFrame(std::move(columnNames), std::move(columns));
+    profile.rows(dataFrame.size(), dataFrame.size());
+    return dataFrame;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+namespace jdf {
+
+class DataFrame;
+
+namespace jsonformat {
+
+    /**
+     * Parses a json document in one of the formats accepted by the DataFrame constructor. The document is
+     * read with a SAX parser that appends the values directly to the columns, so no json DOM of the whole
+     * document is built. Only nested values inside cells are built as json values.
+     * Columns of the column format are ordered by name, like in a DataFrame constructed from a json object.
+     * A "data" array is read as rows only if the document also has "columns", otherwise it is a column.
+     * @throws json::parse_error if the document is not valid json.
+     * @throws std::invalid_argument if the document is not in one of the formats, e.g. rows of different
+     * lengths in the split format or columns of different lengths in the column format.
+     */
+    DataFrame parse(std::string_view text);
+
+    /**
+     * Parses json lines, i.e. one json object per line, directly into columns. Large documents are split
+     * into chunks at line breaks and the chunks are parsed in parallel on the global thread pool.
+     * The columns are the keys of all objects in the order they first appear, rows without a key get null
+     * in its column.
+     * @param firstLine The number of the first line of text in error messages.
+     * @throws json::parse_error if a line is not valid json.
+     * @throws std::invalid_argument with the number of the line if a line is not an object or has a key
+     * twice.
+     */
+    DataFrame parseLines(std::string_view text, size_t firstLine = 1);
+
+}
+
+}
@@ -0,0 +1,115 @@
+#include "JsonWriter.hpp"
+#include "DataFrame.hpp"
+#include "Profiler.hpp"
+#include "TextFormat.hpp"
+
+namespace jdf::jsonformat {
+
+namespace {
+    constexpr size_t rowsPerRange = 1 << 16;
+
+    void appendString(std::string_view value, std::string& out)
+    {
+        constexpr char hexDigits[] = "0123456789abcdef";
+        out += '"';
+        for (const char character : value) {
+            switch (character) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(character) < 0x20) {
+                    out += "\\u00";
+                    out += hexDigits[character >> 4];
+                    out += hexDigits[character & 0xf];
+                } else {
+                    out += character;
+                }
+                break;
+            }
+        }
+        out += '"';
+    }
+
+    void appendValue(const Column& column, size_t row, std::string& out)
+    {
+        if (column.isNull(row)) {
+            out += "null";
+            return;
+        }
+        switch (column.type()) {
+        case ColumnType::Int:
+            textformat::appendNumber(column.values<int64_t>()[row], out);
+            break;
+        case ColumnType::Double:
+            textformat::appendDouble(column.values<double>()[row], out);
+            break;
+        case ColumnType::Bool:
+            out += column.values<uint8_t>()[row] ? "true" : "false";
+            break;
+        case ColumnType::String:
+            appendString(column.string(row), out);
+            break;
+        case ColumnType::Json:
+            out += column.values<json>()[row].dump();
+            break;
+        case ColumnType::Empty:
+            out += "null";
+            break;
+        }
+    }
+}
+
+void formatLines(const DataFrame& dataFrame, size_t begin, size_t end, std::string& out)
+{
+    // The keys are the same for every row, so they are escaped once.
+    std::vector<std::string> keys;
+    for (const auto& name : dataFrame.columnNames()) {
+        std::string key;
+        appendString(name, key);
+        key += ':';
+        keys.push_back(std::move(key));
+    }
+    for (size_t row = begin; row < end; row++) {
+        out += '{';
+        for (size_t column = 0; column < keys.size(); column++) {
+            if (column > 0) {
+                out += ',';
+            }
+            out += keys[column];
+            appendValue(dataFrame.column(column), row, out);
+        }
+        out += "}\n";
+    }
+}
+
+void writeLines(const DataFrame& dataFrame, std::ostream& stream)
+{
+    ProfileScope profile("toNdjson");
+    profile.stage("write");
+    profile.rows(dataFrame.size(), dataFrame.size());
+    size_t bytesWritten = 0;
+    const auto formatRange = [&](size_t begin, size_t end, std::string& out) {
+        formatLines(dataFrame, begin, end, out);
+    };
+    const auto writeRange = [&](const std::string& range) {
+        stream.write(range.data(), range.size());
+        bytesWritten += range.size();
+    };
+    textformat::formatInRanges(dataFrame.size(), rowsPerRange, formatRange, writeRange);
+    profile.bytes(0, bytesWritten);
+}
+
+}
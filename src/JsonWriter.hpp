@@ -0,0 +1,25 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+namespace jdf {
+
+class DataFrame;
+
+namespace jsonformat {
+
+    /**
+     * Appends the rows [begin, end) of a DataFrame to out as json lines, one object per row with the
+     * columns in order.
+     */
+    void formatLines(const DataFrame& dataFrame, size_t begin, size_t end, std::string& out);
+
+    /**
+     * Writes a DataFrame as json lines. Large DataFrames are formatted in row ranges on the global thread
+     * pool and written in order.
+     */
+    void writeLines(const DataFrame& dataFrame, std::ostream& stream);
+
+}
+
+}
@@ -0,0 +1,52 @@
+#include "MappedFile.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace jdf {
+
+MappedFile::MappedFile(std::string_view path, Access access)
+{
+    const std::string pathString { path };
+    const int file = ::open(pathString.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot open " + pathString);
+    }
+    struct stat status;
+    if (::fstat(file, &status) != 0) {
+        const int error = errno;
+        ::close(file);
+        throw std::system_error(error, std::generic_category(), "cannot stat " + pathString);
+    }
+    _size = static_cast<size_t>(status.st_size);
+    if (_size > 0) {
+        void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            ::close(file);
+            throw std::system_error(error, std::generic_category(), "cannot map " + pathString);
+        }
+        _data = static_cast<const char*>(data);
+        if (access == Access::Sequential) {
+            ::madvise(data, _size, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+std::string_view MappedFile::data() const
+{
+    return { _data, _size };
+}
+
+}
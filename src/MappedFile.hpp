@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace jdf {
+
+/**
+ * A read-only memory mapping of a whole file. Pages are loaded lazily by the operating system and shared
+ * with every other process that maps the same file.
+ */
+class MappedFile {
+public:
+    /**
+     * How the mapping will be read. Sequential lets the operating system read ahead aggressively and drop
+     * pages behind the reader, which only helps a single front to back scan.
+     */
+    enum class Access {
+        Random,
+        Sequential,
+    };
+
+    /**
+     * @throws std::system_error if the file cannot be opened or mapped.
+     */
+    MappedFile(std::string_view path, Access access);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    std::string_view data() const;
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+};
+
+}
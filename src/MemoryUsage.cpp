@@ -0,0 +1,33 @@
+#include "MemoryUsage.hpp"
+
+namespace jdf::memory {
+
+size_t jsonSize(const json& value)
+{
+    switch (value.type()) {
+    case json::value_t::string:
+        return allocationSize(sizeof(json::string_t)) + stringSize(value.get_ref<const json::string_t&>());
+    case json::value_t::array: {
+        const auto& array = value.get_ref<const json::array_t&>();
+        size_t size = allocationSize(sizeof(json::array_t)) + vectorSize(array);
+        for (const auto& element : array) {
+            size += jsonSize(element);
+        }
+        return size;
+    }
+    case json::value_t::object: {
+        const auto& object = value.get_ref<const json::object_t&>();
+        size_t size = allocationSize(sizeof(json::object_t));
+        for (const auto& [key, element] : object) {
+            size += mapNodeSize<json::object_t>() + stringSize(key) + jsonSize(element);
+        }
+        return size;
+    }
+    case json::value_t::binary:
+        return allocationSize(sizeof(json::binary_t)) + vectorSize(static_cast<const std::vector<uint8_t>&>(value.get_binary()));
+    default:
+        return 0;
+    }
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace jdf::memory {
+
+using json = nlohmann::json;
+
+/**
+ * Returns the bytes taken by a heap allocation of the given size, including the overhead of a typical
+ * malloc: a size header, 16 byte alignment and a minimum chunk size.
+ */
+constexpr size_t allocationSize(size_t bytes)
+{
+    if (bytes == 0) {
+        return 0;
+    }
+    return std::max<size_t>(32, (bytes + sizeof(size_t) + 15) & ~size_t { 15 });
+}
+
+template <typename T>
+size_t vectorSize(const std::vector<T>& values)
+{
+    return allocationSize(values.capacity() * sizeof(T));
+}
+
+/**
+ * Returns the heap memory of a string, which is zero for short strings stored inside the string object.
+ */
+inline size_t stringSize(const std::string& value)
+{
+    const char* object = reinterpret_cast<const char*>(&value);
+    const bool isInline = value.data() >= object && value.data() < object + sizeof(value);
+    return isInline ? 0 : allocationSize(value.capacity() + 1);
+}
+
+/**
+ * Returns the heap memory of the bucket array and the nodes of an unordered map or set, excluding memory
+ * owned by the values.
+ */
+template <typename HashMap>
+size_t hashMapSize(const HashMap& map)
+{
+    const size_t nodeSize = allocationSize(sizeof(typename HashMap::value_type) + 2 * sizeof(void*));
+    return allocationSize(map.bucket_count() * sizeof(void*)) + map.size() * nodeSize;
+}
+
+/**
+ * Returns the heap memory of one node of a std::map, which holds three pointers and a color besides the
+ * value, excluding memory owned by the value.
+ */
+template <typename Map>
+constexpr size_t mapNodeSize()
+{
+    return allocationSize(4 * sizeof(void*) + sizeof(typename Map::value_type));
+}
+
+/**
+ * Returns the heap memory owned by a json value, excluding the json object itself.
+ */
+size_t jsonSize(const json& value);
+
+}
@@ -0,0 +1,74 @@
+#include "NdjsonBatchReader.hpp"
+#include "JsonReader.hpp"
+#include <cassert>
+
+namespace jdf {
+
+NdjsonBatchReader::NdjsonBatchReader(std::istream& stream, size_t batchSize)
+    : _stream(stream)
+    , _batchSize(batchSize)
+    , _blocks(_stream)
+{
+    assert(_batchSize > 0);
+}
+
+NdjsonBatchReader::NdjsonBatchReader(std::string_view path, size_t batchSize)
+    : _file(std::make_unique<std::ifstream>(std::string { path }, std::ios::binary))
+    , _stream(*_file)
+    , _batchSize(batchSize)
+    , _blocks(_stream)
+{
+    assert(_file->is_open() && _batchSize > 0);
+}
+
+NdjsonBatchReader::~NdjsonBatchReader() = default;
+
+std::optional<DataFrame> NdjsonBatchReader::next()
+{
+    scanLines(_batchSize);
+    while (_recordCount < _batchSize && readBlock()) {
+        scanLines(_batchSize);
+    }
+    // At the end of the input the last line does not need to be terminated by a line break.
+    const size_t end = _recordCount < _batchSize ? _buffer.size() : _lineEnd;
+    DataFrame batch = jsonformat::parseLines(std::string_view(_buffer).substr(_begin, end - _begin), _firstLine);
+    _begin = _scanPosition = _lineEnd = end;
+    _recordCount = 0;
+    _firstLine += _lineCount;
+    _lineCount = 0;
+
+    if (batch.size() == 0) {
+        return std::nullopt;
+    }
+    return batch;
+}
+
+bool NdjsonBatchReader::readBlock()
+{
+    const auto dropped = _blocks.appendTo(_buffer, _begin);
+    if (!dropped) {
+        return false;
+    }
+    _begin -= *dropped;
+    _scanPosition -= *dropped;
+    _lineEnd -= *dropped;
+    return true;
+}
+
+void NdjsonBatchReader::scanLines(size_t maxRecords)
+{
+    while (_recordCount < maxRecords) {
+        const size_t lineBreak = _buffer.find('\n', _scanPosition);
+        if (lineBreak == std::string::npos) {
+            return;
+        }
+        const auto line = std::string_view(_buffer).substr(_scanPosition, lineBreak - _scanPosition);
+        if (line.find_first_not_of(" \t\r") != std::string_view::npos) {
+            _recordCount++;
+        }
+        _scanPosition = _lineEnd = lineBreak + 1;
+        _lineCount++;
+    }
+}
+
+}
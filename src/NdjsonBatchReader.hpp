@@ -0,0 +1,61 @@
+#pragma once
+#include "BlockReader.hpp"
+#include "DataFrame.hpp"
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace jdf {
+
+/**
+ * Reads json lines in batches of a fixed number of records, so that documents larger than the available
+ * memory can be processed one DataFrame at a time. The columns of a batch are the keys of its records.
+ * The input is read in blocks in the background, see BlockReader.
+ */
+class NdjsonBatchReader {
+public:
+    NdjsonBatchReader(std::istream& stream, size_t batchSize);
+    NdjsonBatchReader(std::string_view path, size_t batchSize);
+    ~NdjsonBatchReader();
+
+    NdjsonBatchReader(const NdjsonBatchReader&) = delete;
+    NdjsonBatchReader(NdjsonBatchReader&&) = delete;
+    NdjsonBatchReader& operator=(const NdjsonBatchReader&) = delete;
+    NdjsonBatchReader& operator=(NdjsonBatchReader&&) = delete;
+
+    /**
+     * Returns the next batch of at most batchSize records, or std::nullopt when the input is exhausted.
+     */
+    std::optional<DataFrame> next();
+
+private:
+    /**
+     * Appends the next block of the input to the buffer. Returns false at the end of the input.
+     */
+    bool readBlock();
+
+    /**
+     * Advances the scan position over complete lines until maxRecords non-empty lines have been found or
+     * the buffer is exhausted.
+     */
+    void scanLines(size_t maxRecords);
+
+    std::unique_ptr<std::ifstream> _file;
+    std::istream& _stream;
+    size_t _batchSize;
+    BlockReader _blocks;
+
+    std::string _buffer;
+    size_t _begin = 0;
+    size_t _scanPosition = 0;
+    size_t _lineEnd = 0;
+    size_t _recordCount = 0;
+    // The number of the line at _begin and the number of lines scanned after it, for error messages.
+    size_t _firstLine = 1;
+    size_t _lineCount = 0;
+};
+
+}
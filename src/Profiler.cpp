@@ -0,0 +1,110 @@
+#include "Profiler.hpp"
+#include <atomic>
+
+namespace jdf {
+
+namespace {
+    std::atomic<Profiler*> installedProfiler = nullptr;
+}
+
+json OperationProfile::toJson() const
+{
+    json result = {
+        { "operation", operation },
+        { "rowsScanned", rowsScanned },
+        { "rowsEmitted", rowsEmitted },
+        { "bytesRead", bytesRead },
+        { "bytesWritten", bytesWritten },
+        { "stages", json::array() },
+    };
+    for (const auto& [name, seconds] : stages) {
+        result["stages"].push_back({ { "name", name }, { "seconds", seconds } });
+    }
+    return result;
+}
+
+void Profiler::install(Profiler* profiler)
+{
+    installedProfiler.store(profiler, std::memory_order_release);
+}
+
+Profiler* Profiler::installed()
+{
+    return installedProfiler.load(std::memory_order_acquire);
+}
+
+void Profiler::record(OperationProfile profile)
+{
+    const std::lock_guard lock(_mutex);
+    _operations.push_back(std::move(profile));
+}
+
+std::vector<OperationProfile> Profiler::operations() const
+{
+    const std::lock_guard lock(_mutex);
+    return _operations;
+}
+
+void Profiler::clear()
+{
+    const std::lock_guard lock(_mutex);
+    _operations.clear();
+}
+
+json Profiler::toJson() const
+{
+    const std::lock_guard lock(_mutex);
+    json result = json::array();
+    for (const auto& profile : _operations) {
+        result.push_back(profile.toJson());
+    }
+    return result;
+}
+
+ProfileScope::ProfileScope(std::string_view operation)
+    : _profiler(Profiler::installed())
+{
+    if (_profiler != nullptr) {
+        _profile.operation = operation;
+    }
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (_profiler != nullptr) {
+        endStage();
+        _profiler->record(std::move(_profile));
+    }
+}
+
+void ProfileScope::stage(std::string_view name)
+{
+    if (_profiler != nullptr) {
+        endStage();
+        _profile.stages.emplace_back(name, 0.0);
+        _stageBegin = std::chrono::steady_clock::now();
+        _isInStage = true;
+    }
+}
+
+void ProfileScope::rows(size_t scanned, size_t emitted)
+{
+    _profile.rowsScanned = scanned;
+    _profile.rowsEmitted = emitted;
+}
+
+void ProfileScope::bytes(size_t read, size_t written)
+{
+    _profile.bytesRead = read;
+    _profile.bytesWritten = written;
+}
+
+void ProfileScope::endStage()
+{
+    if (_isInStage) {
+        _profile.stages.back().second = std::chrono::duration<double>(std::chrono::steady_clock::now() - _stageBegin).count();
+        _isInStage = false;
+    }
+}
+
+}
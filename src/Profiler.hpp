@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace jdf {
+
+using json = nlohmann::json;
+
+/**
+ * The statistics of one DataFrame operation. Stages are listed in order with their wall time in seconds.
+ */
+struct OperationProfile {
+    std::string operation;
+    size_t rowsScanned = 0;
+    size_t rowsEmitted = 0;
+    size_t bytesRead = 0;
+    size_t bytesWritten = 0;
+    std::vector<std::pair<std::string, double>> stages;
+
+    json toJson() const;
+};
+
+/**
+ * Collects the profiles of DataFrame operations, e.g. query, fromCsv and toCsv, while it is installed.
+ * Without an installed profiler the instrumentation of the operations costs a single atomic load.
+ */
+class Profiler {
+public:
+    /**
+     * Installs profiler as the receiver of all operation profiles, nullptr uninstalls it. The profiler
+     * has to stay alive while it is installed.
+     */
+    static void install(Profiler* profiler);
+    static Profiler* installed();
+
+    /**
+     * Adds a profile, may be called from any thread.
+     */
+    void record(OperationProfile profile);
+    std::vector<OperationProfile> operations() const;
+    void clear();
+
+    /**
+     * Returns the recorded profiles as a json array, in the order they were recorded.
+     */
+    json toJson() const;
+
+private:
+    mutable std::mutex _mutex;
+    std::vector<OperationProfile> _operations;
+};
+
+/**
+ * Profiles an operation for the installed profiler and records the profile when it goes out of scope.
+ * Nothing is measured if no profiler was installed when the scope was created.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(std::string_view operation);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope(ProfileScope&&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ProfileScope& operator=(ProfileScope&&) = delete;
+
+    /**
+     * Ends the current stage, if any, and starts a new one.
+     */
+    void stage(std::string_view name);
+    void rows(size_t scanned, size_t emitted);
+    void bytes(size_t read, size_t written);
+
+private:
+    void endStage();
+
+    Profiler* _profiler;
+    OperationProfile _profile;
+    std::chrono::steady_clock::time_point _stageBegin;
+    bool _isInStage = false;
+};
+
+}
@@ -0,0 +1,556 @@
+#include "QueryPlan.hpp"
+#include "Bitmap.hpp"
+#include "DataFrame.hpp"
+#include "HashIndex.hpp"
+#include "SortedIndex.hpp"
+#include "ThreadPool.hpp"
+#include "SelectionKernels.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <numeric>
+
+namespace jdf {
+
+namespace {
+    /**
+     * The number of rows that are evaluated as one task. A multiple of the zone map block size, so that
+     * morsels do not share blocks.
+     */
+    constexpr size_t morselSize = 1 << 16;
+    static_assert(morselSize % ZoneMap::blockSize == 0);
+
+    Operator flip(Operator op)
+    {
+        switch (op) {
+        case Operator::Less:
+            return Operator::Greater;
+        case Operator::LessOrEqual:
+            return Operator::GreaterOrEqual;
+        case Operator::Greater:
+            return Operator::Less;
+        case Operator::GreaterOrEqual:
+            return Operator::LessOrEqual;
+        case Operator::Equal:
+        case Operator::NotEqual:
+            break;
+        }
+        return op;
+    }
+
+    template <typename T>
+    bool compare(const T& lhs, Operator op, const T& rhs)
+    {
+        switch (op) {
+        case Operator::Equal:
+            return lhs == rhs;
+        case Operator::NotEqual:
+            return lhs != rhs;
+        case Operator::Less:
+            return lhs < rhs;
+        case Operator::LessOrEqual:
+            return lhs <= rhs;
+        case Operator::Greater:
+            return lhs > rhs;
+        case Operator::GreaterOrEqual:
+            return lhs >= rhs;
+        }
+        return true;
+    }
+
+    /**
+     * A value of the given column type. Comparing values of different json types only depends on the
+     * types, which allows comparisons between mismatched columns and literals to be folded to a constant.
+     */
+    json sampleOf(ColumnType type)
+    {
+        switch (type) {
+        case ColumnType::Int:
+            return int64_t { 0 };
+        case ColumnType::Double:
+            return 0.0;
+        case ColumnType::Bool:
+            return false;
+        case ColumnType::String:
+            return "";
+        case ColumnType::Empty:
+        case ColumnType::Json:
+            break;
+        }
+        return json();
+    }
+
+    bool isNumeric(ColumnType type)
+    {
+        return type == ColumnType::Int || type == ColumnType::Double;
+    }
+
+    void fillMask(uint64_t* mask, size_t count, bool value)
+    {
+        const size_t words = Bitmap::wordCount(count);
+        std::fill_n(mask, words, value ? ~uint64_t { 0 } : 0);
+        if (value && count % 64 != 0) {
+            mask[words - 1] = (uint64_t { 1 } << (count % 64)) - 1;
+        }
+    }
+
+    /**
+     * Evaluates a comparison with a constant for the rows [begin, end) zone map block by zone map block.
+     * Blocks whose bounds decide the comparison are filled without looking at the values, the others
+     * are evaluated by kernel(blockBegin, blockEnd, blockMask).
+     */
+    template <typename T, typename Kernel>
+    void evalBlocks(const ZoneMap& zoneMap, Operator op, T constant, size_t begin, size_t end, uint64_t* mask, Kernel kernel)
+    {
+        for (size_t blockBegin = begin; blockBegin < end;) {
+            const size_t block = blockBegin / ZoneMap::blockSize;
+            const size_t blockEnd = std::min(end, (block + 1) * ZoneMap::blockSize);
+            uint64_t* blockMask = mask + (blockBegin - begin) / 64;
+            switch (zoneMap.match(block, op, constant)) {
+            case BlockMatch::None:
+                fillMask(blockMask, blockEnd - blockBegin, false);
+                break;
+            case BlockMatch::All:
+                fillMask(blockMask, blockEnd - blockBegin, true);
+                break;
+            case BlockMatch::Some:
+                kernel(blockBegin, blockEnd, blockMask);
+                break;
+            }
+            blockBegin = blockEnd;
+        }
+    }
+
+    bool isTypedNull(const Column* column, size_t row)
+    {
+        return column != nullptr && column->nulls() != nullptr && column->nulls()->test(row);
+    }
+
+    uint64_t nullWord(const Column* column, size_t word)
+    {
+        return column != nullptr && column->nulls() != nullptr ? column->nulls()->words()[word] : 0;
+    }
+
+    double numericValue(const Column& column, size_t row)
+    {
+        if (column.type() == ColumnType::Int) {
+            return static_cast<double>(column.values<int64_t>()[row]);
+        }
+        return column.values<double>()[row];
+    }
+}
+
+QueryPlan::QueryPlan(const DataFrame& dataFrame)
+    : _dataFrame(&dataFrame)
+{
+}
+
+QueryPlan QueryPlan::compile(const BooleanExpression& expression, const DataFrame& dataFrame)
+{
+    QueryPlan plan(dataFrame);
+    plan._stackDepth = plan.append(expression);
+    return plan;
+}
+
+QueryPlan QueryPlan::compile(const DataFrame& dataFrame, size_t column, Operator op, const json& value)
+{
+    QueryPlan plan(dataFrame);
+    plan.addLeaf({ &dataFrame.column(column), value, column }, op, { nullptr, value });
+    plan._instructions.push_back({ ExpressionType::Value, 0 });
+    plan._stackDepth = 1;
+    return plan;
+}
+
+size_t QueryPlan::append(const BooleanExpression& expression)
+{
+    if (expression.type == ExpressionType::Value) {
+        const auto& comparison = *expression.comparison;
+        addLeaf(resolve(comparison.col1.value), comparison.op, resolve(comparison.col2.value));
+        _instructions.push_back({ ExpressionType::Value, _leaves.size() - 1 });
+        return 1;
+    }
+
+    // Emitting the deeper operand first keeps the evaluation stack logarithmic in the number of leaves.
+    const size_t begin = _instructions.size();
+    const size_t leftDepth = append(*expression.left);
+    const size_t split = _instructions.size();
+    const size_t rightDepth = append(*expression.right);
+    if (rightDepth > leftDepth) {
+        std::rotate(_instructions.begin() + begin, _instructions.begin() + split, _instructions.end());
+    }
+    _instructions.push_back({ expression.type, 0 });
+    return std::max(std::max(leftDepth, rightDepth), std::min(leftDepth, rightDepth) + 1);
+}
+
+QueryPlan::Operand QueryPlan::resolve(const json& value) const
+{
+    if (value.is_string()) {
+        if (const auto index = _dataFrame->columnIndex(value.get_ref<const std::string&>())) {
+            return { &_dataFrame->column(*index), value, *index };
+        }
+    }
+    return { nullptr, value };
+}
+
+void QueryPlan::addLeaf(Operand lhs, Operator op, Operand rhs)
+{
+    if (lhs.column == nullptr && rhs.column == nullptr) {
+        Leaf leaf { .kind = LeafKind::Constant, .op = op };
+        leaf.constant = compare(lhs.literal, op, rhs.literal);
+        _leaves.push_back(std::move(leaf));
+    } else if (lhs.column == nullptr) {
+        _leaves.push_back(columnConstantLeaf(*rhs.column, flip(op), lhs.literal));
+        useIndex(_leaves.back(), rhs.index, lhs.literal);
+    } else if (rhs.column == nullptr) {
+        _leaves.push_back(columnConstantLeaf(*lhs.column, op, rhs.literal));
+        useIndex(_leaves.back(), lhs.index, rhs.literal);
+    } else {
+        _leaves.push_back(columnColumnLeaf(*lhs.column, op, *rhs.column));
+    }
+}
+
+QueryPlan::Leaf QueryPlan::columnConstantLeaf(const Column& column, Operator op, const json& literal) const
+{
+    Leaf leaf { .kind = LeafKind::Constant, .op = op, .lhs = &column };
+    switch (column.type()) {
+    case ColumnType::Empty:
+        break;
+    case ColumnType::Int:
+        if (literal.is_number_integer() && !(literal.is_number_unsigned() && literal.get<uint64_t>() > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))) {
+            leaf.kind = LeafKind::IntConstant;
+            leaf.intValue = literal.get<int64_t>();
+        } else if (literal.is_number()) {
+            leaf.kind = LeafKind::IntDoubleConstant;
+            leaf.doubleValue = literal.get<double>();
+        }
+        break;
+    case ColumnType::Double:
+        if (literal.is_number()) {
+            leaf.kind = LeafKind::DoubleConstant;
+            leaf.doubleValue = literal.get<double>();
+        }
+        break;
+    case ColumnType::Bool:
+        if (literal.is_boolean()) {
+            leaf.kind = LeafKind::BoolConstant;
+            leaf.intValue = literal.get<bool>();
+        }
+        break;
+    case ColumnType::String:
+        if (literal.is_string()) {
+            leaf.kind = LeafKind::StringConstant;
+            leaf.stringValue = literal.get<std::string>();
+            // (In)equality with a dictionary encoded column compares codes, a value that is not in the
+            // dictionary decides the comparison for all rows.
+            const auto& strings = column.strings();
+            if (strings.isDictionary() && (op == Operator::Equal || op == Operator::NotEqual)) {
+                if (const auto code = strings.dictionary().find(leaf.stringValue)) {
+                    leaf.kind = LeafKind::CodeConstant;
+                    leaf.intValue = *code;
+                } else {
+                    leaf.kind = LeafKind::Constant;
+                    leaf.constant = op == Operator::NotEqual;
+                    return leaf;
+                }
+            }
+        }
+        break;
+    case ColumnType::Json:
+        leaf.kind = LeafKind::JsonConstant;
+        leaf.jsonValue = literal;
+        break;
+    }
+
+    if (leaf.kind == LeafKind::Constant && column.type() != ColumnType::Empty) {
+        leaf.constant = compare(sampleOf(column.type()), op, literal);
+    }
+    leaf.nullsMatch = compare(json(), op, literal);
+    return leaf;
+}
+
+void QueryPlan::useIndex(Leaf& leaf, size_t column, const json& literal) const
+{
+    if (leaf.kind == LeafKind::Constant) {
+        return;
+    }
+    const HashIndex* hashIndex = _dataFrame->hashIndex(column);
+    if (hashIndex != nullptr && leaf.op == Operator::Equal) {
+        if (const auto rows = hashIndex->find(literal)) {
+            leaf.isIndexed = true;
+            leaf.indexedRows.assign(rows->begin(), rows->end());
+            return;
+        }
+    }
+
+    const SortedIndex* sortedIndex = _dataFrame->sortedIndex(column);
+    if (sortedIndex != nullptr) {
+        if (const auto rows = sortedIndex->find(*leaf.lhs, leaf.op, literal)) {
+            // The rows are ordered by value. Sorting them by row only pays off for small results, unless
+            // the column is already ascending in the selected range.
+            const bool isAscending = std::is_sorted(rows->begin(), rows->end());
+            if (isAscending || rows->size() <= leaf.lhs->size() / 8) {
+                leaf.isIndexed = true;
+                leaf.indexedRows.assign(rows->begin(), rows->end());
+                if (!isAscending) {
+                    std::sort(leaf.indexedRows.begin(), leaf.indexedRows.end());
+                }
+            }
+        }
+    }
+}
+
+QueryPlan::Leaf QueryPlan::columnColumnLeaf(const Column& lhs, Operator op, const Column& rhs) const
+{
+    Leaf leaf { .kind = LeafKind::Constant, .op = op, .lhs = &lhs, .rhs = &rhs };
+    if (lhs.type() == ColumnType::Empty || rhs.type() == ColumnType::Empty) {
+        return leaf;
+    }
+
+    if (lhs.type() == ColumnType::Json || rhs.type() == ColumnType::Json) {
+        leaf.kind = LeafKind::JsonColumns;
+    } else if (lhs.type() == ColumnType::Int && rhs.type() == ColumnType::Int) {
+        leaf.kind = LeafKind::IntColumns;
+    } else if (isNumeric(lhs.type()) && isNumeric(rhs.type())) {
+        leaf.kind = LeafKind::NumericColumns;
+    } else if (lhs.type() == ColumnType::Bool && rhs.type() == ColumnType::Bool) {
+        leaf.kind = LeafKind::BoolColumns;
+    } else if (lhs.type() == ColumnType::String && rhs.type() == ColumnType::String) {
+        leaf.kind = LeafKind::StringColumns;
+    } else {
+        leaf.constant = compare(sampleOf(lhs.type()), op, sampleOf(rhs.type()));
+    }
+    return leaf;
+}
+
+std::optional<std::span<const size_t>> QueryPlan::indexedRows() const
+{
+    if (_instructions.size() == 1 && _leaves[_instructions[0].leaf].isIndexed) {
+        return std::span<const size_t>(_leaves[_instructions[0].leaf].indexedRows);
+    }
+    return std::nullopt;
+}
+
+void QueryPlan::evaluate(Bitmap& selection) const
+{
+    assert(selection.size() == _dataFrame->size());
+    const size_t morselCount = (selection.size() + morselSize - 1) / morselSize;
+    ThreadPool::global().run(morselCount, [&](size_t morsel) {
+        const size_t begin = morsel * morselSize;
+        evaluate(begin, std::min(begin + morselSize, selection.size()), selection.words() + begin / 64);
+    });
+}
+
+std::vector<size_t> QueryPlan::selectedRows() const
+{
+    if (const auto rows = indexedRows()) {
+        return std::vector<size_t>(rows->begin(), rows->end());
+    }
+
+    Bitmap selection(_dataFrame->size());
+    evaluate(selection);
+
+    // The indices of each morsel are written at the offset given by the counts of the preceding morsels,
+    // which keeps them in row order.
+    constexpr size_t morselWords = morselSize / 64;
+    const size_t morselCount = (selection.wordCount() + morselWords - 1) / morselWords;
+    if (morselCount <= 1) {
+        return selection.indices();
+    }
+    ThreadPool& pool = ThreadPool::global();
+    std::vector<size_t> offsets(morselCount + 1, 0);
+    pool.run(morselCount, [&](size_t morsel) {
+        offsets[morsel + 1] = selection.count(morsel * morselWords, std::min((morsel + 1) * morselWords, selection.wordCount()));
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<size_t> rows(offsets.back());
+    pool.run(morselCount, [&](size_t morsel) {
+        selection.indices(morsel * morselWords, std::min((morsel + 1) * morselWords, selection.wordCount()), rows.data() + offsets[morsel]);
+    });
+    return rows;
+}
+
+bool QueryPlan::matches(size_t row) const
+{
+    // The stack depth is bounded by the logarithm of the number of leaves, see append().
+    uint64_t stack = 0;
+    for (const auto& instruction : _instructions) {
+        switch (instruction.type) {
+        case ExpressionType::Value:
+            stack = (stack << 1) | static_cast<uint64_t>(evalLeaf(_leaves[instruction.leaf], row));
+            break;
+        case ExpressionType::And:
+            stack = (stack >> 1) & (stack | ~uint64_t { 1 });
+            break;
+        case ExpressionType::Or:
+            stack = (stack >> 1) | (stack & uint64_t { 1 });
+            break;
+        }
+    }
+    return stack & 1;
+}
+
+bool QueryPlan::evalLeaf(const Leaf& leaf, size_t row) const
+{
+    if (isTypedNull(leaf.lhs, row) || isTypedNull(leaf.rhs, row)) {
+        return leaf.rhs == nullptr ? leaf.nullsMatch : compare(leaf.lhs->get(row), leaf.op, leaf.rhs->get(row));
+    }
+    switch (leaf.kind) {
+    case LeafKind::Constant:
+        return leaf.constant;
+    case LeafKind::IntConstant:
+        return compare(leaf.lhs->values<int64_t>()[row], leaf.op, leaf.intValue);
+    case LeafKind::IntDoubleConstant:
+        return compare(static_cast<double>(leaf.lhs->values<int64_t>()[row]), leaf.op, leaf.doubleValue);
+    case LeafKind::DoubleConstant:
+        return compare(leaf.lhs->values<double>()[row], leaf.op, leaf.doubleValue);
+    case LeafKind::BoolConstant:
+        return compare(static_cast<int64_t>(leaf.lhs->values<uint8_t>()[row]), leaf.op, leaf.intValue);
+    case LeafKind::StringConstant:
+        return compare(leaf.lhs->string(row), leaf.op, std::string_view(leaf.stringValue));
+    case LeafKind::CodeConstant:
+        return compare(static_cast<int64_t>(leaf.lhs->strings().codes()[row]), leaf.op, leaf.intValue);
+    case LeafKind::JsonConstant:
+        return compare(leaf.lhs->values<json>()[row], leaf.op, leaf.jsonValue);
+    case LeafKind::IntColumns:
+        return compare(leaf.lhs->values<int64_t>()[row], leaf.op, leaf.rhs->values<int64_t>()[row]);
+    case LeafKind::NumericColumns:
+        return compare(numericValue(*leaf.lhs, row), leaf.op, numericValue(*leaf.rhs, row));
+    case LeafKind::BoolColumns:
+        return compare(leaf.lhs->values<uint8_t>()[row], leaf.op, leaf.rhs->values<uint8_t>()[row]);
+    case LeafKind::StringColumns:
+        return compare(leaf.lhs->string(row), leaf.op, leaf.rhs->string(row));
+    case LeafKind::JsonColumns:
+        return compare(leaf.lhs->get(row), leaf.op, leaf.rhs->get(row));
+    }
+    return false;
+}
+
+void QueryPlan::evaluate(size_t begin, size_t end, uint64_t* mask) const
+{
+    assert(begin % 64 == 0);
+    if (_instructions.size() == 1) {
+        evalLeaf(_leaves[_instructions[0].leaf], begin, end, mask);
+        return;
+    }
+
+    // Small blocks keep the intermediate masks of all leaves in the L1 cache.
+    constexpr size_t blockSize = 4096;
+    constexpr size_t blockWords = Bitmap::wordCount(blockSize);
+    std::vector<uint64_t> stack(_stackDepth * blockWords);
+    for (size_t blockBegin = begin; blockBegin < end; blockBegin += blockSize) {
+        const size_t blockEnd = std::min(end, blockBegin + blockSize);
+        const size_t words = Bitmap::wordCount(blockEnd - blockBegin);
+        size_t depth = 0;
+        for (const auto& instruction : _instructions) {
+            uint64_t* top = stack.data() + depth * blockWords;
+            switch (instruction.type) {
+            case ExpressionType::Value:
+                evalLeaf(_leaves[instruction.leaf], blockBegin, blockEnd, top);
+                depth++;
+                break;
+            case ExpressionType::And:
+                depth--;
+                for (size_t w = 0; w < words; w++) {
+                    (top - 2 * blockWords)[w] &= (top - blockWords)[w];
+                }
+                break;
+            case ExpressionType::Or:
+                depth--;
+                for (size_t w = 0; w < words; w++) {
+                    (top - 2 * blockWords)[w] |= (top - blockWords)[w];
+                }
+                break;
+            }
+        }
+        assert(depth == 1);
+        std::copy_n(stack.data(), words, mask + (blockBegin - begin) / 64);
+    }
+}
+
+void QueryPlan::evalLeaf(const Leaf& leaf, size_t begin, size_t end, uint64_t* mask) const
+{
+    evalValues(leaf, begin, end, mask);
+
+    // The kernels compare the zero values of null rows, their results are replaced row by row.
+    for (size_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+        uint64_t nulls = nullWord(leaf.lhs, wordBegin / 64) | nullWord(leaf.rhs, wordBegin / 64);
+        uint64_t& bits = mask[(wordBegin - begin) / 64];
+        while (nulls != 0) {
+            const size_t bit = std::countr_zero(nulls);
+            nulls &= nulls - 1;
+            bits = (bits & ~(uint64_t { 1 } << bit)) | (static_cast<uint64_t>(evalLeaf(leaf, wordBegin + bit)) << bit);
+        }
+    }
+}
+
+void QueryPlan::evalValues(const Leaf& leaf, size_t begin, size_t end, uint64_t* mask) const
+{
+    const size_t count = end - begin;
+    if (leaf.isIndexed) {
+        std::fill_n(mask, Bitmap::wordCount(count), 0);
+        auto row = std::lower_bound(leaf.indexedRows.begin(), leaf.indexedRows.end(), begin);
+        for (; row != leaf.indexedRows.end() && *row < end; ++row) {
+            mask[(*row - begin) / 64] |= uint64_t { 1 } << ((*row - begin) % 64);
+        }
+        return;
+    }
+
+    switch (leaf.kind) {
+    case LeafKind::IntConstant: {
+        const auto values = leaf.lhs->values<int64_t>();
+        evalBlocks(leaf.lhs->zoneMap(), leaf.op, leaf.intValue, begin, end, mask, [&](size_t blockBegin, size_t blockEnd, uint64_t* blockMask) {
+            kernels::compare(values.subspan(blockBegin, blockEnd - blockBegin), leaf.op, leaf.intValue, blockMask);
+        });
+        return;
+    }
+    case LeafKind::IntDoubleConstant: {
+        const auto values = leaf.lhs->values<int64_t>();
+        evalBlocks(leaf.lhs->zoneMap(), leaf.op, leaf.doubleValue, begin, end, mask, [&](size_t blockBegin, size_t blockEnd, uint64_t* blockMask) {
+            kernels::compareAsDouble(values.subspan(blockBegin, blockEnd - blockBegin), leaf.op, leaf.doubleValue, blockMask);
+        });
+        return;
+    }
+    case LeafKind::DoubleConstant: {
+        const auto values = leaf.lhs->values<double>();
+        evalBlocks(leaf.lhs->zoneMap(), leaf.op, leaf.doubleValue, begin, end, mask, [&](size_t blockBegin, size_t blockEnd, uint64_t* blockMask) {
+            kernels::compare(values.subspan(blockBegin, blockEnd - blockBegin), leaf.op, leaf.doubleValue, blockMask);
+        });
+        return;
+    }
+    case LeafKind::BoolConstant:
+        kernels::compare(leaf.lhs->values<uint8_t>().subspan(begin, count), leaf.op, static_cast<uint8_t>(leaf.intValue), mask);
+        return;
+    case LeafKind::CodeConstant: {
+        const auto codes = leaf.lhs->strings().codes().subspan(begin, count);
+        const auto code = static_cast<uint32_t>(leaf.intValue);
+        const uint64_t flip = leaf.op == Operator::NotEqual ? ~uint64_t { 0 } : 0;
+        for (size_t wordBegin = 0; wordBegin < count; wordBegin += 64) {
+            const size_t wordEnd = std::min(count, wordBegin + 64);
+            uint64_t bits = 0;
+            for (size_t i = wordBegin; i < wordEnd; i++) {
+                bits |= static_cast<uint64_t>(codes[i] == code) << (i - wordBegin);
+            }
+            const size_t length = wordEnd - wordBegin;
+            mask[wordBegin / 64] = (bits ^ flip) & (length == 64 ? ~uint64_t { 0 } : (uint64_t { 1 } << length) - 1);
+        }
+        return;
+    }
+    case LeafKind::Constant:
+        fillMask(mask, count, leaf.constant);
+        return;
+    default:
+        break;
+    }
+
+    for (size_t wordBegin = begin; wordBegin < end; wordBegin += 64) {
+        const size_t wordEnd = std::min(end, wordBegin + 64);
+        uint64_t bits = 0;
+        for (size_t row = wordBegin; row < wordEnd; row++) {
+            bits |= static_cast<uint64_t>(evalLeaf(leaf, row)) << (row - wordBegin);
+        }
+        mask[(wordBegin - begin) / 64] = bits;
+    }
+}
+
+}
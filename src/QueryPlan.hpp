@@ -0,0 +1,119 @@
+#pragma once
+#include "BooleanExpression.hpp"
+#include "Column.hpp"
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace jdf {
+
+class Bitmap;
+class DataFrame;
+
+/**
+ * A BooleanExpression compiled against the columns of a DataFrame.
+ * Column references are resolved to columns, literals are converted to the type of the column they are
+ * compared with and every comparison is specialized for the types of its operands. The expression tree is
+ * flattened into a postfix program, so evaluating a row does neither string lookups nor recursion.
+ * @note A plan refers to the columns of the DataFrame it was compiled for and is invalidated when that
+ * DataFrame is modified.
+ */
+class QueryPlan {
+public:
+    static QueryPlan compile(const BooleanExpression& expression, const DataFrame& dataFrame);
+
+    /**
+     * Compiles a single comparison between a column and a literal value.
+     */
+    static QueryPlan compile(const DataFrame& dataFrame, size_t column, Operator op, const json& value);
+
+    bool matches(size_t row) const;
+
+    /**
+     * Evaluates the plan for the rows [begin, end) and writes the result as a selection bitmask, bit i of
+     * mask[w] being the result for row begin + 64 * w + i. begin must be a multiple of 64.
+     * Leaves are evaluated block by block with vectorized kernels, And and Or combine the masks bitwise.
+     * Comparisons of numeric columns with a constant skip the blocks that the zone map of the column
+     * decides, comparisons that can be answered by an index set the bits of the indexed rows.
+     */
+    void evaluate(size_t begin, size_t end, uint64_t* mask) const;
+
+    /**
+     * Returns the selected rows if the plan is a single comparison that can be answered by an index.
+     */
+    std::optional<std::span<const size_t>> indexedRows() const;
+
+    /**
+     * Evaluates the plan for all rows of the DataFrame. The rows are split into morsels, which are
+     * evaluated in parallel on the global thread pool.
+     */
+    void evaluate(Bitmap& selection) const;
+
+    /**
+     * Returns all rows of the DataFrame for which the plan holds, in ascending order.
+     */
+    std::vector<size_t> selectedRows() const;
+
+private:
+    enum class LeafKind {
+        Constant,
+        IntConstant,
+        IntDoubleConstant,
+        DoubleConstant,
+        BoolConstant,
+        StringConstant,
+        CodeConstant,
+        JsonConstant,
+        IntColumns,
+        NumericColumns,
+        BoolColumns,
+        StringColumns,
+        JsonColumns,
+    };
+
+    struct Leaf {
+        LeafKind kind;
+        Operator op;
+        const Column* lhs = nullptr;
+        const Column* rhs = nullptr;
+        bool constant = false;
+        int64_t intValue = 0;
+        double doubleValue = 0.0;
+        std::string stringValue {};
+        json jsonValue {};
+        // The result for a null in a typed column compared with a constant, the same as for a json null.
+        bool nullsMatch = false;
+        bool isIndexed = false;
+        std::vector<size_t> indexedRows {};
+    };
+
+    struct Instruction {
+        ExpressionType type;
+        size_t leaf;
+    };
+
+    struct Operand {
+        const Column* column;
+        const json& literal;
+        size_t index = 0;
+    };
+
+    explicit QueryPlan(const DataFrame& dataFrame);
+    size_t append(const BooleanExpression& expression);
+    Operand resolve(const json& value) const;
+    void addLeaf(Operand lhs, Operator op, Operand rhs);
+    Leaf columnConstantLeaf(const Column& column, Operator op, const json& literal) const;
+    void useIndex(Leaf& leaf, size_t column, const json& literal) const;
+    Leaf columnColumnLeaf(const Column& lhs, Operator op, const Column& rhs) const;
+    bool evalLeaf(const Leaf& leaf, size_t row) const;
+    void evalLeaf(const Leaf& leaf, size_t begin, size_t end, uint64_t* mask) const;
+    void evalValues(const Leaf& leaf, size_t begin, size_t end, uint64_t* mask) const;
+
+    const DataFrame* _dataFrame;
+    size_t _stackDepth = 0;
+    std::vector<Leaf> _leaves;
+    std::vector<Instruction> _instructions;
+};
+
+}
@@ -0,0 +1,263 @@
+#include "SelectionKernels.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define JDF_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace jdf::kernels {
+
+namespace {
+    template <Operator Op, typename T>
+    bool compareOp(T lhs, T rhs)
+    {
+        if constexpr (Op == Operator::Equal) {
+            return lhs == rhs;
+        } else if constexpr (Op == Operator::NotEqual) {
+            return lhs != rhs;
+        } else if constexpr (Op == Operator::Less) {
+            return lhs < rhs;
+        } else if constexpr (Op == Operator::LessOrEqual) {
+            return lhs <= rhs;
+        } else if constexpr (Op == Operator::Greater) {
+            return lhs > rhs;
+        } else {
+            return lhs >= rhs;
+        }
+    }
+
+    /**
+     * Scalar kernel, values are converted to the type of the constant before comparing.
+     */
+    template <Operator Op, typename T, typename U>
+    void compareScalar(const T* values, size_t count, U constant, uint64_t* mask)
+    {
+        for (size_t begin = 0; begin < count; begin += 64) {
+            const size_t n = std::min<size_t>(64, count - begin);
+            uint64_t bits = 0;
+            for (size_t i = 0; i < n; i++) {
+                bits |= static_cast<uint64_t>(compareOp<Op>(static_cast<U>(values[begin + i]), constant)) << i;
+            }
+            mask[begin / 64] = bits;
+        }
+    }
+
+    template <typename Kernel>
+    void dispatch(Operator op, Kernel&& kernel)
+    {
+        switch (op) {
+        case Operator::Equal:
+            kernel.template operator()<Operator::Equal>();
+            break;
+        case Operator::NotEqual:
+            kernel.template operator()<Operator::NotEqual>();
+            break;
+        case Operator::Less:
+            kernel.template operator()<Operator::Less>();
+            break;
+        case Operator::LessOrEqual:
+            kernel.template operator()<Operator::LessOrEqual>();
+            break;
+        case Operator::Greater:
+            kernel.template operator()<Operator::Greater>();
+            break;
+        case Operator::GreaterOrEqual:
+            kernel.template operator()<Operator::GreaterOrEqual>();
+            break;
+        }
+    }
+
+#ifdef JDF_X86_KERNELS
+    bool hasAvx2()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    bool hasSse42()
+    {
+        static const bool supported = __builtin_cpu_supports("sse4.2");
+        return supported;
+    }
+
+    /**
+     * Integer comparisons only exist for == and >, the other operators swap the operands or negate the
+     * result.
+     */
+    template <Operator Op>
+    constexpr bool isNegated()
+    {
+        return Op == Operator::NotEqual || Op == Operator::LessOrEqual || Op == Operator::GreaterOrEqual;
+    }
+
+    template <Operator Op>
+    constexpr int avxPredicate()
+    {
+        switch (Op) {
+        case Operator::Equal:
+            return _CMP_EQ_OQ;
+        case Operator::NotEqual:
+            return _CMP_NEQ_UQ;
+        case Operator::Less:
+            return _CMP_LT_OQ;
+        case Operator::LessOrEqual:
+            return _CMP_LE_OQ;
+        case Operator::Greater:
+            return _CMP_GT_OQ;
+        case Operator::GreaterOrEqual:
+            return _CMP_GE_OQ;
+        }
+        return _CMP_FALSE_OQ;
+    }
+
+    template <Operator Op>
+    __attribute__((target("avx2"))) void compareAvx2(const int64_t* values, size_t count, int64_t constant, uint64_t* mask)
+    {
+        const __m256i c = _mm256_set1_epi64x(constant);
+        const size_t words = count / 64;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = 0;
+            for (size_t i = 0; i < 64; i += 4) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + w * 64 + i));
+                __m256i m;
+                if constexpr (Op == Operator::Equal || Op == Operator::NotEqual) {
+                    m = _mm256_cmpeq_epi64(v, c);
+                } else if constexpr (Op == Operator::Greater || Op == Operator::LessOrEqual) {
+                    m = _mm256_cmpgt_epi64(v, c);
+                } else {
+                    m = _mm256_cmpgt_epi64(c, v);
+                }
+                uint64_t lanes = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+                if constexpr (isNegated<Op>()) {
+                    lanes ^= 0xF;
+                }
+                bits |= lanes << i;
+            }
+            mask[w] = bits;
+        }
+        compareScalar<Op>(values + words * 64, count - words * 64, constant, mask + words);
+    }
+
+    template <Operator Op>
+    __attribute__((target("sse4.2"))) void compareSse42(const int64_t* values, size_t count, int64_t constant, uint64_t* mask)
+    {
+        const __m128i c = _mm_set1_epi64x(constant);
+        const size_t words = count / 64;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = 0;
+            for (size_t i = 0; i < 64; i += 2) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + w * 64 + i));
+                __m128i m;
+                if constexpr (Op == Operator::Equal || Op == Operator::NotEqual) {
+                    m = _mm_cmpeq_epi64(v, c);
+                } else if constexpr (Op == Operator::Greater || Op == Operator::LessOrEqual) {
+                    m = _mm_cmpgt_epi64(v, c);
+                } else {
+                    m = _mm_cmpgt_epi64(c, v);
+                }
+                uint64_t lanes = static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(m)));
+                if constexpr (isNegated<Op>()) {
+                    lanes ^= 0x3;
+                }
+                bits |= lanes << i;
+            }
+            mask[w] = bits;
+        }
+        compareScalar<Op>(values + words * 64, count - words * 64, constant, mask + words);
+    }
+
+    template <Operator Op>
+    __attribute__((target("avx2"))) void compareAvx2(const double* values, size_t count, double constant, uint64_t* mask)
+    {
+        constexpr int predicate = avxPredicate<Op>();
+        const __m256d c = _mm256_set1_pd(constant);
+        const size_t words = count / 64;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = 0;
+            for (size_t i = 0; i < 64; i += 4) {
+                const __m256d v = _mm256_loadu_pd(values + w * 64 + i);
+                const __m256d m = _mm256_cmp_pd(v, c, predicate);
+                bits |= static_cast<uint64_t>(_mm256_movemask_pd(m)) << i;
+            }
+            mask[w] = bits;
+        }
+        compareScalar<Op>(values + words * 64, count - words * 64, constant, mask + words);
+    }
+
+    template <Operator Op>
+    void compareSse2(const double* values, size_t count, double constant, uint64_t* mask)
+    {
+        const __m128d c = _mm_set1_pd(constant);
+        const size_t words = count / 64;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = 0;
+            for (size_t i = 0; i < 64; i += 2) {
+                const __m128d v = _mm_loadu_pd(values + w * 64 + i);
+                __m128d m;
+                if constexpr (Op == Operator::Equal) {
+                    m = _mm_cmpeq_pd(v, c);
+                } else if constexpr (Op == Operator::NotEqual) {
+                    m = _mm_cmpneq_pd(v, c);
+                } else if constexpr (Op == Operator::Less) {
+                    m = _mm_cmplt_pd(v, c);
+                } else if constexpr (Op == Operator::LessOrEqual) {
+                    m = _mm_cmple_pd(v, c);
+                } else if constexpr (Op == Operator::Greater) {
+                    m = _mm_cmpgt_pd(v, c);
+                } else {
+                    m = _mm_cmpge_pd(v, c);
+                }
+                bits |= static_cast<uint64_t>(_mm_movemask_pd(m)) << i;
+            }
+            mask[w] = bits;
+        }
+        compareScalar<Op>(values + words * 64, count - words * 64, constant, mask + words);
+    }
+#endif
+}
+
+void compare(std::span<const int64_t> values, Operator op, int64_t constant, uint64_t* mask)
+{
+    dispatch(op, [&]<Operator Op>() {
+#ifdef JDF_X86_KERNELS
+        if (hasAvx2()) {
+            return compareAvx2<Op>(values.data(), values.size(), constant, mask);
+        }
+        if (hasSse42()) {
+            return compareSse42<Op>(values.data(), values.size(), constant, mask);
+        }
+#endif
+        compareScalar<Op>(values.data(), values.size(), constant, mask);
+    });
+}
+
+void compare(std::span<const double> values, Operator op, double constant, uint64_t* mask)
+{
+    dispatch(op, [&]<Operator Op>() {
+#ifdef JDF_X86_KERNELS
+        if (hasAvx2()) {
+            return compareAvx2<Op>(values.data(), values.size(), constant, mask);
+        }
+        return compareSse2<Op>(values.data(), values.size(), constant, mask);
+#else
+        compareScalar<Op>(values.data(), values.size(), constant, mask);
+#endif
+    });
+}
+
+void compare(std::span<const uint8_t> values, Operator op, uint8_t constant, uint64_t* mask)
+{
+    dispatch(op, [&]<Operator Op>() {
+        compareScalar<Op>(values.data(), values.size(), constant, mask);
+    });
+}
+
+void compareAsDouble(std::span<const int64_t> values, Operator op, double constant, uint64_t* mask)
+{
+    dispatch(op, [&]<Operator Op>() {
+        compareScalar<Op>(values.data(), values.size(), constant, mask);
+    });
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "BooleanExpression.hpp"
+#include <cstdint>
+#include <span>
+
+namespace jdf::kernels {
+
+/**
+ * Compares every value with a constant and writes the result as a bitmask, bit i of mask[w] being the
+ * result for values[64 * w + i]. mask must hold Bitmap::wordCount(values.size()) words, bits past the end
+ * of values are cleared.
+ * The kernels use AVX2 or SSE4.2 when the cpu supports it and fall back to scalar code otherwise.
+ */
+void compare(std::span<const int64_t> values, Operator op, int64_t constant, uint64_t* mask);
+void compare(std::span<const double> values, Operator op, double constant, uint64_t* mask);
+void compare(std::span<const uint8_t> values, Operator op, uint8_t constant, uint64_t* mask);
+
+/**
+ * Compares integer values with a floating point constant, converting each value to double first.
+ */
+void compareAsDouble(std::span<const int64_t> values, Operator op, double constant, uint64_t* mask);
+
+}
@@ -0,0 +1,237 @@
+#include "Sort.hpp"
+#include "DataFrame.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace jdf {
+
+namespace {
+    constexpr size_t minRowsPerRun = 1 << 14;
+
+    std::vector<const Column*> keyColumns(const DataFrame& dataFrame, const std::vector<std::string>& columns)
+    {
+        std::vector<const Column*> keys;
+        for (const auto& name : columns) {
+            const auto index = dataFrame.columnIndex(name);
+            assert(index.has_value());
+            keys.push_back(&dataFrame.column(*index));
+        }
+        return keys;
+    }
+
+    /**
+     * Maps the values of a numeric column to unsigned integers with the same order, NaN mapping to the
+     * largest integer in either direction.
+     */
+    std::vector<uint64_t> radixKeys(const Column& column, bool ascending)
+    {
+        constexpr uint64_t signBit = uint64_t { 1 } << 63;
+        std::vector<uint64_t> keys(column.size());
+        for (size_t row = 0; row < keys.size(); row++) {
+            uint64_t key = 0;
+            switch (column.type()) {
+            case ColumnType::Int:
+                key = std::bit_cast<uint64_t>(column.values<int64_t>()[row]) ^ signBit;
+                break;
+            case ColumnType::Bool:
+                key = column.values<uint8_t>()[row];
+                break;
+            case ColumnType::Double: {
+                const double value = column.values<double>()[row];
+                if (std::isnan(value)) {
+                    keys[row] = std::numeric_limits<uint64_t>::max();
+                    continue;
+                }
+                // Adding 0.0 turns -0.0 into 0.0, negative values are ordered by their inverted bits.
+                const uint64_t bits = std::bit_cast<uint64_t>(value + 0.0);
+                key = (bits & signBit) != 0 ? ~bits : bits ^ signBit;
+                break;
+            }
+            default:
+                assert(false);
+                break;
+            }
+            keys[row] = ascending ? key : ~key;
+        }
+        return keys;
+    }
+
+    /**
+     * Stable LSD radix sort of the rows in permutation by keys[row], one byte per pass. Passes in which all
+     * keys have the same byte are skipped.
+     */
+    void radixSort(std::vector<size_t>& permutation, const std::vector<uint64_t>& keys)
+    {
+        struct Entry {
+            uint64_t key;
+            size_t row;
+        };
+        std::vector<Entry> entries(permutation.size());
+        std::vector<Entry> buffer(permutation.size());
+        for (size_t i = 0; i < permutation.size(); i++) {
+            entries[i] = { keys[permutation[i]], permutation[i] };
+        }
+
+        for (size_t shift = 0; shift < 64; shift += 8) {
+            std::array<size_t, 257> offsets {};
+            for (const Entry& entry : entries) {
+                offsets[((entry.key >> shift) & 0xff) + 1]++;
+            }
+            if (std::find(offsets.begin(), offsets.end(), entries.size()) != offsets.end()) {
+                continue;
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            for (const Entry& entry : entries) {
+                buffer[offsets[(entry.key >> shift) & 0xff]++] = entry;
+            }
+            entries.swap(buffer);
+        }
+
+        for (size_t i = 0; i < permutation.size(); i++) {
+            permutation[i] = entries[i].row;
+        }
+    }
+
+    bool isTypedNull(const Column& column, size_t row)
+    {
+        return column.nulls() != nullptr && column.nulls()->test(row);
+    }
+
+    /**
+     * Compares the values of two rows, NaN being larger than any other value. Values of different json
+     * types are ordered by type, which puts nulls first.
+     */
+    int compareValues(const Column& column, size_t lhs, size_t rhs)
+    {
+        const auto compare = [](const auto& lhsValue, const auto& rhsValue) {
+            return lhsValue < rhsValue ? -1 : rhsValue < lhsValue ? 1
+                                                                  : 0;
+        };
+        if (column.nulls() != nullptr && (isTypedNull(column, lhs) || isTypedNull(column, rhs))) {
+            return isTypedNull(column, rhs) - isTypedNull(column, lhs);
+        }
+        switch (column.type()) {
+        case ColumnType::Int:
+            return compare(column.values<int64_t>()[lhs], column.values<int64_t>()[rhs]);
+        case ColumnType::Double: {
+            const double lhsValue = column.values<double>()[lhs];
+            const double rhsValue = column.values<double>()[rhs];
+            if (std::isnan(lhsValue) || std::isnan(rhsValue)) {
+                return std::isnan(lhsValue) - std::isnan(rhsValue);
+            }
+            return compare(lhsValue, rhsValue);
+        }
+        case ColumnType::Bool:
+            return compare(column.values<uint8_t>()[lhs], column.values<uint8_t>()[rhs]);
+        case ColumnType::String:
+            return compare(column.string(lhs), column.string(rhs));
+        case ColumnType::Json:
+            return compare(column.values<json>()[lhs], column.values<json>()[rhs]);
+        case ColumnType::Empty:
+            break;
+        }
+        return 0;
+    }
+
+    bool isNaN(const Column& column, size_t row)
+    {
+        return column.type() == ColumnType::Double && std::isnan(column.values<double>()[row]) && !isTypedNull(column, row);
+    }
+
+    /**
+     * Stable merge sort of permutation: runs are sorted in parallel, then merged pairwise in parallel.
+     */
+    template <typename Less>
+    void parallelMergeSort(std::vector<size_t>& permutation, Less less)
+    {
+        ThreadPool& pool = ThreadPool::global();
+        const size_t runCount = std::clamp<size_t>(permutation.size() / minRowsPerRun, 1, pool.threadCount());
+        std::vector<size_t> bounds(runCount + 1);
+        for (size_t run = 0; run <= runCount; run++) {
+            bounds[run] = permutation.size() * run / runCount;
+        }
+        pool.run(runCount, [&](size_t run) {
+            std::stable_sort(permutation.begin() + bounds[run], permutation.begin() + bounds[run + 1], less);
+        });
+
+        std::vector<size_t> buffer(permutation.size());
+        for (size_t width = 1; width < runCount; width *= 2) {
+            const size_t mergeCount = (runCount + 2 * width - 1) / (2 * width);
+            pool.run(mergeCount, [&](size_t merge) {
+                const size_t begin = bounds[2 * width * merge];
+                const size_t middle = bounds[std::min(runCount, 2 * width * merge + width)];
+                const size_t end = bounds[std::min(runCount, 2 * width * (merge + 1))];
+                std::merge(permutation.begin() + begin, permutation.begin() + middle, permutation.begin() + middle, permutation.begin() + end, buffer.begin() + begin, less);
+            });
+            permutation.swap(buffer);
+        }
+    }
+}
+
+std::vector<size_t> argsort(const DataFrame& dataFrame, const std::vector<std::string>& columns, bool ascending)
+{
+    const auto keys = keyColumns(dataFrame, columns);
+    std::vector<size_t> permutation(dataFrame.size());
+    std::iota(permutation.begin(), permutation.end(), size_t { 0 });
+
+    const bool isNumeric = std::all_of(keys.begin(), keys.end(), [](const Column* key) {
+        const bool isNumericType = key->type() == ColumnType::Int || key->type() == ColumnType::Double || key->type() == ColumnType::Bool;
+        return isNumericType && key->nulls() == nullptr;
+    });
+    if (isNumeric) {
+        // Sorting stably by each column, from the least to the most significant, sorts by all of them.
+        for (auto key = keys.rbegin(); key != keys.rend(); ++key) {
+            radixSort(permutation, radixKeys(**key, ascending));
+        }
+        return permutation;
+    }
+
+    parallelMergeSort(permutation, [&](size_t lhs, size_t rhs) {
+        for (const Column* key : keys) {
+            const int comparison = compareValues(*key, lhs, rhs);
+            if (comparison != 0) {
+                const bool hasNaN = isNaN(*key, lhs) || isNaN(*key, rhs);
+                return ascending || hasNaN ? comparison < 0 : comparison > 0;
+            }
+        }
+        return false;
+    });
+    return permutation;
+}
+
+std::vector<size_t> topKRows(const DataFrame& dataFrame, std::string_view column, size_t k)
+{
+    const Column& key = dataFrame.column(column);
+    // A row is better than another one if it comes first in the result, the top of the heap is the worst
+    // row that is kept.
+    const auto isBetter = [&](size_t lhs, size_t rhs) {
+        const int comparison = compareValues(key, lhs, rhs);
+        if (comparison == 0) {
+            return lhs < rhs;
+        }
+        return isNaN(key, lhs) || isNaN(key, rhs) ? comparison < 0 : comparison > 0;
+    };
+
+    std::vector<size_t> heap;
+    heap.reserve(std::min(k, dataFrame.size()));
+    for (size_t row = 0; row < dataFrame.size() && k > 0; row++) {
+        if (heap.size() < k) {
+            heap.push_back(row);
+            std::push_heap(heap.begin(), heap.end(), isBetter);
+        } else if (isBetter(row, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), isBetter);
+            heap.back() = row;
+            std::push_heap(heap.begin(), heap.end(), isBetter);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), isBetter);
+    return heap;
+}
+
+}
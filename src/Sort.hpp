@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jdf {
+
+class DataFrame;
+
+/**
+ * Returns the permutation of rows that sorts a DataFrame by the given columns, the first column being the
+ * most significant. The sort is stable, NaN values are placed last in either direction. Nulls are smaller
+ * than any other value, like in json.
+ * Keys that are all Int, Double or Bool columns without nulls are sorted with an LSD radix sort, other keys with a
+ * merge sort whose runs are sorted and merged in parallel on the global thread pool.
+ */
+std::vector<size_t> argsort(const DataFrame& dataFrame, const std::vector<std::string>& columns, bool ascending);
+
+/**
+ * Returns the rows with the k largest values of column, largest first and equal values in row order.
+ * Uses a heap of k rows instead of sorting all rows.
+ */
+std::vector<size_t> topKRows(const DataFrame& dataFrame, std::string_view column, size_t k);
+
+}
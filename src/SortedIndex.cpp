@@ -0,0 +1,205 @@
+#include "SortedIndex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace jdf {
+
+namespace {
+    /**
+     * Returns the value of a row as T, which is the type that constants are compared in.
+     */
+    template <typename T>
+    T valueOf(const Column& column, size_t row)
+    {
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            return column.string(row);
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return column.values<int64_t>()[row];
+        } else if (column.type() == ColumnType::Int) {
+            return static_cast<double>(column.values<int64_t>()[row]);
+        } else {
+            return column.values<double>()[row];
+        }
+    }
+
+    template <typename T>
+    std::span<const size_t> findRange(std::span<const size_t> rows, const Column& column, Operator op, T constant)
+    {
+        const auto lower = std::partition_point(rows.begin(), rows.end(), [&](size_t row) {
+            return valueOf<T>(column, row) < constant;
+        });
+        const auto upper = std::partition_point(lower, rows.end(), [&](size_t row) {
+            return !(constant < valueOf<T>(column, row));
+        });
+        switch (op) {
+        case Operator::Equal:
+            return { lower, upper };
+        case Operator::Less:
+            return { rows.begin(), lower };
+        case Operator::LessOrEqual:
+            return { rows.begin(), upper };
+        case Operator::Greater:
+            return { upper, rows.end() };
+        case Operator::GreaterOrEqual:
+            return { lower, rows.end() };
+        case Operator::NotEqual:
+            break;
+        }
+        return {};
+    }
+
+    bool isNull(const Column& column, size_t row)
+    {
+        return column.nulls() != nullptr && column.nulls()->test(row);
+    }
+
+    template <typename T>
+    void insertRows(std::vector<size_t>& rows, const Column& column, size_t begin)
+    {
+        const auto less = [&](size_t lhs, size_t rhs) {
+            return valueOf<T>(column, lhs) < valueOf<T>(column, rhs);
+        };
+        const size_t indexedCount = rows.size();
+        for (size_t row = begin; row < column.size(); row++) {
+            if (isNull(column, row)) {
+                continue;
+            }
+            if constexpr (std::is_floating_point_v<T>) {
+                if (std::isnan(valueOf<T>(column, row))) {
+                    continue;
+                }
+            }
+            rows.push_back(row);
+        }
+        // The new rows are sorted on their own and merged with the indexed ones in one pass, both steps are
+        // stable and keep equal values in row order. Rows appended in ascending order skip both.
+        const auto added = rows.begin() + static_cast<std::ptrdiff_t>(indexedCount);
+        if (!std::is_sorted(added, rows.end(), less)) {
+            std::stable_sort(added, rows.end(), less);
+        }
+        if (added != rows.begin() && added != rows.end() && less(*added, *(added - 1))) {
+            std::inplace_merge(rows.begin(), added, rows.end(), less);
+        }
+    }
+
+    std::vector<size_t> nonNullRows(const Column& column)
+    {
+        std::vector<size_t> rows;
+        rows.reserve(column.size());
+        for (size_t row = 0; row < column.size(); row++) {
+            if (!isNull(column, row)) {
+                rows.push_back(row);
+            }
+        }
+        return rows;
+    }
+}
+
+SortedIndex::SortedIndex(const Column& column)
+{
+    update(column);
+}
+
+void SortedIndex::update(const Column& column)
+{
+    size_t begin = _rowCount;
+    if (column.type() != _type) {
+        _type = column.type();
+        _rows.clear();
+        begin = 0;
+    }
+    _rowCount = column.size();
+
+    switch (_type) {
+    case ColumnType::Int:
+        if (begin == 0) {
+            // Building from scratch sorts once instead of inserting row by row.
+            _rows = nonNullRows(column);
+            const auto values = column.values<int64_t>();
+            std::stable_sort(_rows.begin(), _rows.end(), [&](size_t lhs, size_t rhs) {
+                return values[lhs] < values[rhs];
+            });
+        } else {
+            insertRows<int64_t>(_rows, column, begin);
+        }
+        break;
+    case ColumnType::Double:
+        if (begin == 0) {
+            const auto values = column.values<double>();
+            for (size_t row = 0; row < values.size(); row++) {
+                if (!std::isnan(values[row]) && !isNull(column, row)) {
+                    _rows.push_back(row);
+                }
+            }
+            std::stable_sort(_rows.begin(), _rows.end(), [&](size_t lhs, size_t rhs) {
+                return values[lhs] < values[rhs];
+            });
+        } else {
+            insertRows<double>(_rows, column, begin);
+        }
+        break;
+    case ColumnType::String:
+        if (begin == 0) {
+            _rows = nonNullRows(column);
+            std::stable_sort(_rows.begin(), _rows.end(), [&](size_t lhs, size_t rhs) {
+                return column.string(lhs) < column.string(rhs);
+            });
+        } else {
+            insertRows<std::string_view>(_rows, column, begin);
+        }
+        break;
+    case ColumnType::Empty:
+    case ColumnType::Bool:
+    case ColumnType::Json:
+        _rows.clear();
+        break;
+    }
+}
+
+std::optional<std::span<const size_t>> SortedIndex::find(const Column& column, Operator op, const json& constant) const
+{
+    // A null compares less than any number or string, see QueryPlan, but nulls are not indexed.
+    const bool nullsMatch = column.nulls() != nullptr && (op == Operator::Less || op == Operator::LessOrEqual);
+    if (op == Operator::NotEqual || column.type() != _type || nullsMatch) {
+        return std::nullopt;
+    }
+    if (constant.is_number_float() && std::isnan(constant.get<double>())) {
+        return std::span<const size_t> {};
+    }
+
+    switch (_type) {
+    case ColumnType::Int:
+        if (constant.is_number_integer() && !(constant.is_number_unsigned() && constant.get<uint64_t>() > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))) {
+            return findRange(std::span<const size_t>(_rows), column, op, constant.get<int64_t>());
+        }
+        if (constant.is_number()) {
+            // Converting to double preserves the order, so the rows stay sorted when compared as doubles.
+            return findRange(std::span<const size_t>(_rows), column, op, constant.get<double>());
+        }
+        break;
+    case ColumnType::Double:
+        if (constant.is_number()) {
+            return findRange(std::span<const size_t>(_rows), column, op, constant.get<double>());
+        }
+        break;
+    case ColumnType::String:
+        if (constant.is_string()) {
+            return findRange(std::span<const size_t>(_rows), column, op, std::string_view(constant.get_ref<const std::string&>()));
+        }
+        break;
+    case ColumnType::Empty:
+    case ColumnType::Bool:
+    case ColumnType::Json:
+        break;
+    }
+    return std::nullopt;
+}
+
+size_t SortedIndex::memoryUsage() const
+{
+    return memory::vectorSize(_rows);
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "BooleanExpression.hpp"
+#include "Column.hpp"
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * The rows of an Int, Double or String column ordered by value, rows with equal values in ascending order.
+ * Range comparisons with a constant are answered by binary search. NaN values are not indexed, since they
+ * never satisfy a comparison that the index answers. Nulls are not indexed either, comparisons that they
+ * satisfy are left to the scan.
+ * The index is kept up to date by calling update() after rows have been appended to the column. Appending
+ * values in ascending order, e.g. timestamps, is cheap, other rows cost a sort of the appended rows and a
+ * merge with the indexed ones, so updating after every single row is linear in the column size.
+ */
+class SortedIndex {
+public:
+    explicit SortedIndex(const Column& column);
+
+    /**
+     * Indexes the rows that have been appended to column since the last update.
+     */
+    void update(const Column& column);
+
+    /**
+     * Returns the rows of column for which "value op constant" holds, ordered by value, or std::nullopt
+     * if the comparison cannot be answered by the index. column has to be the indexed column.
+     */
+    std::optional<std::span<const size_t>> find(const Column& column, Operator op, const json& constant) const;
+    size_t memoryUsage() const;
+
+private:
+    ColumnType _type = ColumnType::Empty;
+    size_t _rowCount = 0;
+    std::vector<size_t> _rows;
+};
+
+}
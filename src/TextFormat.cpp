@@ -0,0 +1,42 @@
+#include "TextFormat.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace jdf::textformat {
+
+void appendDouble(double value, std::string& out)
+{
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+    if (std::find_if(buffer, result.ptr, [](char c) { return c == '.' || c == 'e'; }) == result.ptr) {
+        out += ".0";
+    }
+}
+
+void formatInRanges(size_t rowCount, size_t rowsPerRange, const std::function<void(size_t begin, size_t end, std::string& out)>& format, const std::function<void(const std::string& range)>& write)
+{
+    ThreadPool& pool = ThreadPool::global();
+    const size_t rangeCount = (rowCount + rowsPerRange - 1) / rowsPerRange;
+    const size_t rangesPerWave = pool.threadCount() * 2;
+    std::vector<std::string> ranges(rangesPerWave);
+    for (size_t waveBegin = 0; waveBegin < rangeCount; waveBegin += rangesPerWave) {
+        const size_t waveSize = std::min(rangesPerWave, rangeCount - waveBegin);
+        pool.run(waveSize, [&](size_t i) {
+            const size_t begin = (waveBegin + i) * rowsPerRange;
+            ranges[i].clear();
+            format(begin, std::min(begin + rowsPerRange, rowCount), ranges[i]);
+        });
+        for (size_t i = 0; i < waveSize; i++) {
+            write(ranges[i]);
+        }
+    }
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace jdf::textformat {
+
+template <typename T>
+void appendNumber(T value, std::string& out)
+{
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+/**
+ * Formats doubles like json does, i.e. integral values keep a ".0" so that they are read back as doubles
+ * and non finite values become null.
+ */
+void appendDouble(double value, std::string& out);
+
+/**
+ * Formats rows [0, rowCount) in ranges of rowsPerRange rows on the global thread pool and passes the
+ * formatted ranges to write, in order. Formatting a bounded number of ranges at a time limits the memory
+ * to a few ranges per thread.
+ */
+void formatInRanges(size_t rowCount, size_t rowsPerRange, const std::function<void(size_t begin, size_t end, std::string& out)>& format, const std::function<void(const std::string& range)>& write);
+
+}
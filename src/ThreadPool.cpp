@@ -0,0 +1,146 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace jdf {
+
+namespace {
+    thread_local bool isInsideTask = false;
+
+    /**
+     * Marks the current thread as executing tasks of a pool until the scope is left.
+     */
+    class TaskScope {
+    public:
+        TaskScope()
+            : _wasInsideTask(isInsideTask)
+        {
+            isInsideTask = true;
+        }
+        ~TaskScope()
+        {
+            isInsideTask = _wasInsideTask;
+        }
+
+        TaskScope(const TaskScope&) = delete;
+        TaskScope& operator=(const TaskScope&) = delete;
+
+    private:
+        bool _wasInsideTask;
+    };
+
+    std::unique_ptr<ThreadPool>& globalPool()
+    {
+        static auto pool = std::make_unique<ThreadPool>();
+        return pool;
+    }
+}
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    for (size_t i = 1; i < std::max<size_t>(threadCount, 1); i++) {
+        _workers.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _wakeUp.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::threadCount() const
+{
+    return _workers.size() + 1;
+}
+
+void ThreadPool::run(size_t taskCount, const std::function<void(size_t)>& task)
+{
+    if (taskCount == 0) {
+        return;
+    }
+    if (isInsideTask || _workers.empty() || taskCount == 1) {
+        for (size_t i = 0; i < taskCount; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard runLock(_runMutex);
+    {
+        std::lock_guard lock(_mutex);
+        _task = &task;
+        _taskCount = taskCount;
+        _nextTask = 0;
+        _exception = nullptr;
+        _activeWorkers = _workers.size();
+        _generation++;
+    }
+    _wakeUp.notify_all();
+
+    execute();
+
+    std::unique_lock lock(_mutex);
+    _done.wait(lock, [this] { return _activeWorkers == 0; });
+    _task = nullptr;
+    if (_exception) {
+        std::rethrow_exception(std::exchange(_exception, nullptr));
+    }
+}
+
+ThreadPool& ThreadPool::global()
+{
+    return *globalPool();
+}
+
+void ThreadPool::setGlobalThreadCount(size_t threadCount)
+{
+    globalPool() = std::make_unique<ThreadPool>(threadCount);
+}
+
+void ThreadPool::work()
+{
+    size_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(_mutex);
+            _wakeUp.wait(lock, [&] { return _stop || _generation != generation; });
+            if (_stop) {
+                return;
+            }
+            generation = _generation;
+        }
+
+        execute();
+
+        std::lock_guard lock(_mutex);
+        if (--_activeWorkers == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::execute()
+{
+    TaskScope scope;
+    try {
+        for (size_t i = _nextTask++; i < _taskCount; i = _nextTask++) {
+            (*_task)(i);
+        }
+    } catch (...) {
+        _nextTask = _taskCount;
+        std::lock_guard lock(_mutex);
+        if (!_exception) {
+            _exception = std::current_exception();
+        }
+    }
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * A fixed set of worker threads that execute indexed tasks.
+ * Idle threads take the next task from a shared counter, so threads that finish their tasks early take
+ * over the remaining work and the load is balanced without assigning tasks to threads up front.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    /**
+     * Returns the number of threads that execute tasks, including the calling thread.
+     */
+    size_t threadCount() const;
+
+    /**
+     * Calls task(i) for every i in [0, taskCount) and returns when all calls have finished.
+     * The calling thread takes part in the work. Calls from inside a task run sequentially on the calling
+     * thread. If a task throws, the tasks that have not started yet are skipped and the first exception is
+     * rethrown on the calling thread once all running tasks have finished.
+     */
+    void run(size_t taskCount, const std::function<void(size_t)>& task);
+
+    /**
+     * The pool shared by all parallel DataFrame operations. It uses one thread per hardware thread unless
+     * configured otherwise by setGlobalThreadCount.
+     */
+    static ThreadPool& global();
+
+    /**
+     * Replaces the global pool by one with the given number of threads. Must not be called while a
+     * parallel operation is running.
+     */
+    static void setGlobalThreadCount(size_t threadCount);
+
+private:
+    void work();
+    void execute();
+
+    std::vector<std::thread> _workers;
+    std::mutex _runMutex;
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::condition_variable _done;
+    const std::function<void(size_t)>* _task = nullptr;
+    size_t _taskCount = 0;
+    std::atomic<size_t> _nextTask = 0;
+    std::exception_ptr _exception;
+    size_t _activeWorkers = 0;
+    size_t _generation = 0;
+    bool _stop = false;
+};
+
+}
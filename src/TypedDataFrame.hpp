@@ -0,0 +1,237 @@
+#pragma once
+#include "DataFrame.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * A string literal that can be used as a template argument, e.g. Field<"x", double>.
+ */
+template <size_t N>
+struct FixedString {
+    constexpr FixedString(const char (&str)[N])
+    {
+        std::copy_n(str, N, value);
+    }
+    constexpr std::string_view view() const
+    {
+        return std::string_view(value, N - 1);
+    }
+
+    char value[N];
+};
+
+/**
+ * A column of a TypedDataFrame schema: its name and the type of its values.
+ */
+template <FixedString Name, typename T>
+struct Field {
+    static constexpr std::string_view name = Name.view();
+    using type = T;
+};
+
+/**
+ * A DataFrame with a schema that is known at compile time, e.g.
+ *   TypedDataFrame<Field<"x", double>, Field<"y", double>, Field<"label", std::string>>
+ * Columns are accessed by a name that is resolved at compile time, so accessing a value neither hashes a
+ * string nor checks a type. Rows can be read as tuples of references or as plain structs.
+ * bool columns are stored as uint8_t, so that their values can be referenced.
+ */
+template <typename... Fields>
+class TypedDataFrame {
+    template <typename T>
+    using StorageOf = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+
+public:
+    using RowRef = std::tuple<const StorageOf<typename Fields::type>&...>;
+    static constexpr size_t columnCount = sizeof...(Fields);
+
+    /**
+     * Returns the position of the column with the given name, or columnCount if there is none.
+     */
+    template <FixedString Name>
+    static constexpr size_t indexOf()
+    {
+        constexpr std::array<std::string_view, columnCount> names = { Fields::name... };
+        return std::find(names.begin(), names.end(), Name.view()) - names.begin();
+    }
+
+    TypedDataFrame() = default;
+
+    /**
+     * Converts the columns of a DataFrame with the names of the schema, in one pass per column.
+     */
+    explicit TypedDataFrame(const DataFrame& dataFrame)
+    {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (convertFrom<I>(dataFrame.column(Fields::name)), ...);
+        }(std::index_sequence_for<Fields...> {});
+    }
+
+    DataFrame toDataFrame() const
+    {
+        std::vector<std::string> columnNames = { std::string(Fields::name)... };
+        std::vector<Column> columns;
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (columns.push_back(convertTo<I>()), ...);
+        }(std::index_sequence_for<Fields...> {});
+        return DataFrame(std::move(columnNames), std::move(columns));
+    }
+
+    size_t size() const
+    {
+        return std::get<0>(_columns).size();
+    }
+
+    void addRow(const typename Fields::type&... values)
+    {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (std::get<I>(_columns).push_back(values), ...);
+        }(std::index_sequence_for<Fields...> {});
+    }
+
+    void reserve(size_t rows)
+    {
+        std::apply([&](auto&... columns) { (columns.reserve(rows), ...); }, _columns);
+    }
+
+    template <FixedString Name>
+    const auto& column() const
+    {
+        constexpr size_t index = indexOf<Name>();
+        static_assert(index < columnCount, "The schema has no column of this name");
+        return std::get<index>(_columns);
+    }
+
+    template <FixedString Name>
+    const auto& get(size_t row) const
+    {
+        return column<Name>()[row];
+    }
+
+    RowRef row(size_t row) const
+    {
+        return std::apply([&](const auto&... columns) { return RowRef(columns[row]...); }, _columns);
+    }
+
+    /**
+     * Returns a row as an aggregate whose members are initialized by the columns in schema order.
+     */
+    template <typename Struct>
+    Struct as(size_t row) const
+    {
+        return std::apply([&](const auto&... columns) { return Struct { static_cast<typename Fields::type>(columns[row])... }; }, _columns);
+    }
+
+    /**
+     * Calls function with the values of every row, one argument per column.
+     */
+    template <typename Function>
+    void forEach(Function&& function) const
+    {
+        for (size_t row = 0; row < size(); row++) {
+            std::apply([&](const auto&... columns) { function(columns[row]...); }, _columns);
+        }
+    }
+
+    struct Iterator {
+        const TypedDataFrame* dataFrame;
+        size_t row;
+
+        RowRef operator*() const
+        {
+            return dataFrame->row(row);
+        }
+        Iterator& operator++()
+        {
+            row++;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const
+        {
+            return row != other.row;
+        }
+    };
+
+    Iterator begin() const
+    {
+        return { this, 0 };
+    }
+    Iterator end() const
+    {
+        return { this, size() };
+    }
+
+private:
+    template <size_t I>
+    void convertFrom(const Column& column)
+    {
+        using T = typename std::tuple_element_t<I, std::tuple<Fields...>>::type;
+        auto& values = std::get<I>(_columns);
+        values.reserve(column.size());
+        const auto copy = [&](auto source) {
+            for (const auto value : source) {
+                // Narrowing e.g. 256 or 0.5 to uint8_t would give false.
+                if constexpr (std::is_same_v<T, bool>) {
+                    values.push_back(value != 0);
+                } else {
+                    values.push_back(static_cast<StorageOf<T>>(value));
+                }
+            }
+        };
+        if constexpr (std::is_arithmetic_v<T>) {
+            // Null rows take the per-row path, which reports them like Json nulls.
+            switch (column.nulls() == nullptr ? column.type() : ColumnType::Json) {
+            case ColumnType::Int:
+                copy(column.values<int64_t>());
+                return;
+            case ColumnType::Double:
+                copy(column.values<double>());
+                return;
+            case ColumnType::Bool:
+                copy(column.values<uint8_t>());
+                return;
+            default:
+                break;
+            }
+        }
+        for (size_t row = 0; row < column.size(); row++) {
+            values.push_back(column.value<T>(row));
+        }
+    }
+
+    template <size_t I>
+    Column convertTo() const
+    {
+        using T = typename std::tuple_element_t<I, std::tuple<Fields...>>::type;
+        const auto& values = std::get<I>(_columns);
+        if constexpr (std::is_same_v<T, bool>) {
+            return Column(ColumnBuffer<uint8_t>(values));
+        } else if constexpr (std::is_integral_v<T> && sizeof(T) <= sizeof(int64_t) && !(std::is_unsigned_v<T> && sizeof(T) == sizeof(int64_t))) {
+            return Column(ColumnBuffer<int64_t>(std::vector<int64_t>(values.begin(), values.end())));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return Column(ColumnBuffer<double>(std::vector<double>(values.begin(), values.end())));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            return Column(StringBuffer(values));
+        } else {
+            Column column;
+            for (const auto& value : values) {
+                column.push_back(json(value));
+            }
+            return column;
+        }
+    }
+
+    std::tuple<std::vector<StorageOf<typename Fields::type>>...> _columns;
+};
+
+}
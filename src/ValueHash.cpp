@@ -0,0 +1,35 @@
+#include "ValueHash.hpp"
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <string_view>
+
+namespace jdf {
+
+uint64_t hashDouble(double value)
+{
+    if (value >= -0x1p63 && value < 0x1p63 && value == std::trunc(value)) {
+        return std::hash<int64_t> {}(static_cast<int64_t>(value));
+    }
+    return std::hash<double> {}(value);
+}
+
+uint64_t hashJson(const json& value)
+{
+    // json stores non-negative integers as unsigned, they hash like the equal int64_t if they fit.
+    if (value.is_number_integer() && (!value.is_number_unsigned() || value.get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))) {
+        return std::hash<int64_t> {}(value.get<int64_t>());
+    }
+    if (value.is_number()) {
+        return hashDouble(value.get<double>());
+    }
+    if (value.is_boolean()) {
+        return value.get<bool>();
+    }
+    if (value.is_string()) {
+        return std::hash<std::string_view> {}(value.get_ref<const std::string&>());
+    }
+    return std::hash<json> {}(value);
+}
+
+}
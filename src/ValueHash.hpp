@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace jdf {
+
+using json = nlohmann::json;
+
+/**
+ * Hashes a double such that integral values hash like the equal int64_t, so that Int and Double values
+ * that compare equal have the same hash.
+ */
+uint64_t hashDouble(double value);
+
+/**
+ * Hashes a json value consistently with its operator==, which treats numbers of different types as equal,
+ * e.g. 1 and 1.0.
+ */
+uint64_t hashJson(const json& value);
+
+}
@@ -0,0 +1,141 @@
+#include "ZoneMap.hpp"
+#include "MemoryUsage.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace jdf {
+
+namespace {
+    template <typename T, typename U>
+    BlockMatch matchBounds(T min, T max, Operator op, U constant)
+    {
+        switch (op) {
+        case Operator::Equal:
+            return max < constant || min > constant ? BlockMatch::None
+                : min == constant && max == constant ? BlockMatch::All
+                                                     : BlockMatch::Some;
+        case Operator::NotEqual:
+            return min == constant && max == constant ? BlockMatch::None
+                : max < constant || min > constant    ? BlockMatch::All
+                                                      : BlockMatch::Some;
+        case Operator::Less:
+            return min >= constant ? BlockMatch::None : max < constant ? BlockMatch::All : BlockMatch::Some;
+        case Operator::LessOrEqual:
+            return min > constant ? BlockMatch::None : max <= constant ? BlockMatch::All : BlockMatch::Some;
+        case Operator::Greater:
+            return max <= constant ? BlockMatch::None : min > constant ? BlockMatch::All : BlockMatch::Some;
+        case Operator::GreaterOrEqual:
+            return max < constant ? BlockMatch::None : min >= constant ? BlockMatch::All : BlockMatch::Some;
+        }
+        return BlockMatch::Some;
+    }
+}
+
+ZoneMap::ZoneMap(size_t rowCount, std::vector<int64_t> bounds)
+    : _rowCount(rowCount)
+    , _intBounds(std::move(bounds))
+{
+    assert(_intBounds.size() == 2 * blockCount());
+}
+
+ZoneMap::ZoneMap(size_t rowCount, std::vector<double> bounds)
+    : _rowCount(rowCount)
+    , _doubleBounds(std::move(bounds))
+{
+    assert(_doubleBounds.size() == 2 * blockCount());
+}
+
+void ZoneMap::update(std::span<const int64_t> values)
+{
+    if (!_doubleBounds.empty()) {
+        clear();
+    }
+    extend(values, _intBounds);
+}
+
+void ZoneMap::update(std::span<const double> values)
+{
+    if (!_intBounds.empty()) {
+        clear();
+    }
+    extend(values, _doubleBounds);
+}
+
+void ZoneMap::clear()
+{
+    _rowCount = 0;
+    _intBounds.clear();
+    _doubleBounds.clear();
+}
+
+template <typename T>
+void ZoneMap::extend(std::span<const T> values, std::vector<T>& bounds)
+{
+    for (size_t row = _rowCount; row < values.size(); row++) {
+        const T value = values[row];
+        if (row % blockSize == 0) {
+            bounds.push_back(std::numeric_limits<T>::max());
+            bounds.push_back(std::numeric_limits<T>::lowest());
+        }
+        T& min = bounds[bounds.size() - 2];
+        T& max = bounds.back();
+        if constexpr (std::is_floating_point_v<T>) {
+            if (std::isnan(value)) {
+                min = -std::numeric_limits<T>::infinity();
+                max = std::numeric_limits<T>::infinity();
+                continue;
+            }
+        }
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    _rowCount = values.size();
+}
+
+size_t ZoneMap::blockCount() const
+{
+    return (_rowCount + blockSize - 1) / blockSize;
+}
+
+size_t ZoneMap::memoryUsage() const
+{
+    return memory::vectorSize(_intBounds) + memory::vectorSize(_doubleBounds);
+}
+
+std::span<const int64_t> ZoneMap::intBounds() const
+{
+    return _intBounds;
+}
+
+std::span<const double> ZoneMap::doubleBounds() const
+{
+    return _doubleBounds;
+}
+
+BlockMatch ZoneMap::match(size_t block, Operator op, int64_t constant) const
+{
+    assert(block < blockCount() && !_intBounds.empty());
+    return matchBounds(_intBounds[2 * block], _intBounds[2 * block + 1], op, constant);
+}
+
+BlockMatch ZoneMap::match(size_t block, Operator op, double constant) const
+{
+    assert(block < blockCount());
+    if (std::isnan(constant)) {
+        return op == Operator::NotEqual ? BlockMatch::All : BlockMatch::None;
+    }
+    if (!_intBounds.empty()) {
+        return matchBounds(static_cast<double>(_intBounds[2 * block]), static_cast<double>(_intBounds[2 * block + 1]), op, constant);
+    }
+    const double min = _doubleBounds[2 * block];
+    const double max = _doubleBounds[2 * block + 1];
+    if (std::isinf(min) && std::isinf(max) && min < max) {
+        // The block may contain NaN, which only matches NotEqual.
+        return matchBounds(min, max, op, constant) == BlockMatch::None ? BlockMatch::None : BlockMatch::Some;
+    }
+    return matchBounds(min, max, op, constant);
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "BooleanExpression.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace jdf {
+
+/**
+ * Whether the rows of a block can satisfy a comparison: for none, some or all of the rows.
+ */
+enum class BlockMatch {
+    None,
+    Some,
+    All,
+};
+
+/**
+ * The minimum and maximum value of every block of blockSize rows of a numeric column, which allows a query
+ * to skip blocks that cannot match a comparison with a constant and to select blocks that match entirely.
+ * A block containing NaN gets the bounds [-inf, inf], so it is always evaluated.
+ */
+class ZoneMap {
+public:
+    static constexpr size_t blockSize = 4096;
+
+    ZoneMap() = default;
+
+    /**
+     * Constructs a zone map of rowCount rows from the interleaved minimum and maximum of each block, as
+     * returned by intBounds() and doubleBounds().
+     */
+    ZoneMap(size_t rowCount, std::vector<int64_t> bounds);
+    ZoneMap(size_t rowCount, std::vector<double> bounds);
+
+    /**
+     * Extends the zone map over the values appended since the last update. Switching between Int and
+     * Double values starts over.
+     */
+    void update(std::span<const int64_t> values);
+    void update(std::span<const double> values);
+    void clear();
+
+    size_t blockCount() const;
+    size_t memoryUsage() const;
+    std::span<const int64_t> intBounds() const;
+    std::span<const double> doubleBounds() const;
+
+    /**
+     * Returns which rows of a block can satisfy "value op constant". Int blocks can be compared with double
+     * constants, since the conversion to double preserves the order.
+     */
+    BlockMatch match(size_t block, Operator op, int64_t constant) const;
+    BlockMatch match(size_t block, Operator op, double constant) const;
+
+private:
+    template <typename T>
+    void extend(std::span<const T> values, std::vector<T>& bounds);
+
+    size_t _rowCount = 0;
+    std::vector<int64_t> _intBounds;
+    std::vector<double> _doubleBounds;
+};
+
+}